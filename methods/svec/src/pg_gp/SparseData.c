@@ -185,6 +185,49 @@ SparseData float8arr_to_sdata(double *array, int count) {
 	return arr_to_sdata((char *)array, sizeof(float8), FLOAT8OID, count);
 }
 
+/**
+ * @param array A palloc'd array of doubles, which the result takes over
+ * @param count The size of array
+ * @return A SparseData representation of array
+ *
+ * Unlike float8arr_to_sdata(), the runs are compressed in a single pass into
+ * the memory of array itself, without copying values or growing StringInfos
+ * run by run. The index cannot be longer than count bytes, because a count
+ * word never takes more bytes than the length of its run. As in
+ * arr_to_sdata(), values are compared bitwise.
+ */
+SparseData float8arr_to_sdata_inplace(double *array, int count) {
+	char *index = (char *)palloc(Max(count,1));
+	int indexsize = 0;
+	int num_runs = 0;
+	int64 run_len = 1;
+	uint64 run_bits, curr_bits;
+
+	if (count == 0)
+		return makeInplaceSparseData((char *)array,index,0,0,FLOAT8OID,0,0);
+
+	memcpy(&run_bits,&array[0],sizeof(float8));
+	for (int i=1; i<count; i++) {
+		memcpy(&curr_bits,&array[i],sizeof(float8));
+		if (curr_bits == run_bits) {
+			run_len++;
+			continue;
+		}
+		/* Runs are written to the front of array, behind the reader */
+		memcpy(&array[num_runs++],&run_bits,sizeof(float8));
+		int8_to_compword(run_len,index + indexsize);
+		indexsize += int8compstoragesize(index + indexsize);
+		run_bits = curr_bits;
+		run_len = 1;
+	}
+	memcpy(&array[num_runs++],&run_bits,sizeof(float8));
+	int8_to_compword(run_len,index + indexsize);
+	indexsize += int8compstoragesize(index + indexsize);
+
+	return makeInplaceSparseData((char *)array,index,
+			num_runs*sizeof(float8),indexsize,FLOAT8OID,num_runs,count);
+}
+
 /**
  * @param array The array of values to be converted to values in SparseData
  * @param array_pos The array of positions to be converted to runs in SparseData
@@ -338,6 +381,13 @@ double *sdata_to_float8arr(SparseData sdata) {
 			       errmsg("Error allocating memory for array\n")));
 	}
 
+	/* Every run has length 1, so the values are the elements */
+	if (SDATA_IS_UNCOMPRESSED(sdata)) {
+		memcpy(array,sdata->vals->data,
+		       sizeof(double)*(sdata->total_value_count));
+		return array;
+	}
+
 	iptr = sdata->index->data;
 	aptr = 0;
 	for (int i=0; i<sdata->unique_value_count; i++) {
@@ -376,6 +426,26 @@ int64 *sdata_index_to_int64arr(SparseData sdata) {
 	return(array_ix);
 }
 
+/**
+ * @return An array with the end position of each run (counting from 1),
+ * i.e., the prefix sums of the (compressed) count array of a SparseData.
+ * Element idx of the SparseData is in run sdata_find_run(array, ..., idx).
+ */
+int64 *sdata_index_to_run_ends(SparseData sdata) {
+	char *iptr;
+	int64 *run_ends = (int64 *)palloc(
+			sizeof(int64)*(sdata->unique_value_count));
+	int64 read = 0;
+
+	iptr = sdata->index->data;
+	for (int i=0; i<sdata->unique_value_count; i++,
+			iptr+=int8compstoragesize(iptr)) {
+		read += compword_to_int8(iptr);
+		run_ends[i] = read;
+	}
+	return(run_ends);
+}
+
 /**
  * @param target The memory area to store the serialised SparseData
  * @para source The SparseData to be serialised
@@ -453,6 +523,25 @@ double sd_proj(SparseData sdata, int idx) {
 	return vals[i];
 }
 
+/**
+ * @param sdata The SparseData to be projected on
+ * @param run_ends The run ends of sdata, see sdata_index_to_run_ends()
+ * @param idx The index to be projected
+ * @return The element of a SparseData at location idx. Unlike sd_proj(), 
+ * this takes logarithmic time.
+ */
+double sd_proj_decoded(SparseData sdata, const int64 *run_ends, int idx) {
+	double * vals = (double *)sdata->vals->data;
+
+	/* error checking */
+	if (0 >= idx || idx > sdata->total_value_count)
+		ereport(ERROR, 
+			(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+			 errmsg("Index out of bounds.")));
+
+	return vals[sdata_find_run(run_ends,sdata->unique_value_count,idx)];
+}
+
 /**
  * @param sdata The SparseData from which to extract a subarray
  * @param start The start index of the desired subarray
@@ -110,6 +110,18 @@ typedef SparseDataStruct *SparseData;
  * @return True if x is a scalar */
 #define SDATA_IS_SCALAR(x)	(((((x)->unique_value_count)==((x)->total_value_count))&&((x)->total_value_count==1)) ? 1 : 0)
 
+/** 
+ * @return True if every run of x has length 1, i.e., the values of x are the
+ * elements of the vector (this includes the case index->data == NULL) */
+#define SDATA_IS_UNCOMPRESSED(x)	((x)->unique_value_count == (x)->total_value_count)
+
+/**
+ * Minimal ratio of unique values to total values for which element-wise
+ * operations expand a SparseData into a plain array instead of walking its
+ * runs; see sdata_is_dense()
+ */
+#define SDATA_DENSE_RATIO	0.5
+
 /** 
  * @param ptr Pointer to the start of the count entry of a SparseData
  * @return The size of the integer count in an RLE index pointed to by ptr 
@@ -147,7 +159,9 @@ StringInfo makeStringInfoFromData(char *data,int len);
 /* Conversion to and from arrays */
 double *sdata_to_float8arr(SparseData sdata);
 int64 *sdata_index_to_int64arr(SparseData sdata);
+int64 *sdata_index_to_run_ends(SparseData sdata);
 SparseData float8arr_to_sdata(double *array, int count);
+SparseData float8arr_to_sdata_inplace(double *array, int count);
 SparseData position_to_sdata(double *array, int64 *array_pos, int count, int64 end, double base_val);
 SparseData arr_to_sdata(char *array, size_t width, Oid type_of_data, int count);
 SparseData posit_to_sdata(char *array, int64* array_pos, size_t width, Oid type_of_data, int count, int64 end, char *base_val);
@@ -155,6 +169,7 @@ SparseData posit_to_sdata(char *array, int64* array_pos, size_t width, Oid type_
 /* Some functions for accessing and changing elements of a SparseData */
 SparseData lapply(text * func, SparseData sdata);
 double sd_proj(SparseData sdata, int idx);
+double sd_proj_decoded(SparseData sdata, const int64 *run_ends, int idx);
 SparseData subarr(SparseData sdata, int start, int end);
 SparseData reverse(SparseData sdata);
 SparseData concat(SparseData left, SparseData right);
@@ -176,6 +191,26 @@ size_of_type(Oid type)
 	return(1);
 }
 
+/* Returns the run that contains element idx (counting from 1), given the
+ * run ends returned by sdata_index_to_run_ends(). This is a binary search for
+ * the first run that ends at or after idx.
+ */
+static inline int
+sdata_find_run(const int64 *run_ends, int num_runs, int64 idx)
+{
+	int lo = 0, hi = num_runs - 1, mid;
+
+	while (lo < hi)
+	{
+		mid = lo + (hi - lo) / 2;
+		if (run_ends[mid] < idx)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
 /* Appends a count to the count array 
  */
 static inline void append_to_rle_index(StringInfo index, int64 run_len)
@@ -882,6 +917,59 @@ static inline double l1norm_sdata_values_double(SparseData sdata) {
 	return accum_sdata_values_double(sdata, myabs);
 }
 
+/* Returns true if the runs of a SparseData of float8s are so short that
+ * element-wise operations are faster on the expanded array
+ */
+static inline bool sdata_is_dense(SparseData sdata)
+{
+	return sdata->type_of_data == FLOAT8OID &&
+		sdata->unique_value_count >=
+			SDATA_DENSE_RATIO * sdata->total_value_count;
+}
+
+/* Element-wise operation on two dense SparseData of float8s
+ *
+ * We expand both arguments into plain arrays, so that each operation is a
+ * simple loop that the compiler can vectorize, and compress the result into
+ * runs again only once at the end, in place (see
+ * float8arr_to_sdata_inplace()). Uncompressed arguments need not be expanded.
+ */
+static inline SparseData op_sdata_by_sdata_dense(enum operation_t operation,
+					   SparseData left, SparseData right)
+{
+	int count = left->total_value_count;
+	double *result, *rvals;
+	SparseData sdata;
+
+	check_sdata_dimensions(left,right);
+
+	result = sdata_to_float8arr(left);
+	rvals = SDATA_IS_UNCOMPRESSED(right)
+		? (double *)right->vals->data : sdata_to_float8arr(right);
+
+	switch (operation)
+	{
+		case subtract:
+			for (int k=0; k<count; k++) result[k] -= rvals[k];
+			break;
+		case add:
+		default:
+			for (int k=0; k<count; k++) result[k] += rvals[k];
+			break;
+		case multiply:
+			for (int k=0; k<count; k++) result[k] *= rvals[k];
+			break;
+		case divide:
+			for (int k=0; k<count; k++) result[k] /= rvals[k];
+			break;
+	}
+
+	sdata = float8arr_to_sdata_inplace(result,count);
+	if (rvals != (double *)right->vals->data)
+		pfree(rvals);
+	return sdata;
+}
+
 /* 
  * Addition, Scalar Product, Division between SparseData arrays
  *
@@ -894,7 +982,12 @@ static inline double l1norm_sdata_values_double(SparseData sdata) {
 static inline SparseData op_sdata_by_sdata(enum operation_t operation,
 					   SparseData left, SparseData right)
 {
-	SparseData sdata = makeSparseData();
+	SparseData sdata;
+
+	if (sdata_is_dense(left) && sdata_is_dense(right))
+		return op_sdata_by_sdata_dense(operation,left,right);
+
+	sdata = makeSparseData();
 
 	/*
 	 * Loop over the contents of the left array, operating on elements
@@ -1000,6 +1093,130 @@ static inline SparseData op_sdata_by_sdata(enum operation_t operation,
 	return sdata;
 }
 
+/*
+ * Merge-walk over the run-length indexes of two SparseData
+ *
+ * The cursor visits the maximal segments in which neither the left nor the
+ * right value changes. After each successful call of sdata_pair_cursor_next(),
+ * i and j are the positions of the current left and right values, and
+ * run_length is the length of the segment. Nothing is allocated, so kernels
+ * that only reduce two SparseData to a scalar (like the dot product) do not
+ * need an intermediate SparseData.
+ */
+typedef struct
+{
+	char *liptr;        /* index entry of the next left run */
+	char *riptr;        /* index entry of the next right run */
+	int i;              /* current left value */
+	int j;              /* current right value */
+	int64 left_nxt;     /* end position of the current left run */
+	int64 right_nxt;    /* end position of the current right run */
+	int64 pos;          /* end position of the current segment */
+	int64 total;        /* number of elements of both SparseData */
+	int64 run_length;   /* length of the current segment */
+} SparseDataPairCursor;
+
+static inline void
+sdata_pair_cursor_init(SparseDataPairCursor *cursor,
+		SparseData left, SparseData right)
+{
+	check_sdata_dimensions(left,right);
+
+	cursor->liptr = left->index->data;
+	cursor->riptr = right->index->data;
+	cursor->i = -1;
+	cursor->j = -1;
+	cursor->left_nxt = 0;
+	cursor->right_nxt = 0;
+	cursor->pos = 0;
+	cursor->total = left->total_value_count;
+	cursor->run_length = 0;
+}
+
+/* Advances the cursor to the next segment; returns false at the end. The
+ * loops skip runs of length 0.
+ */
+static inline bool
+sdata_pair_cursor_next(SparseDataPairCursor *cursor)
+{
+	int64 nextpos;
+
+	if (cursor->pos >= cursor->total)
+		return false;
+
+	while (cursor->left_nxt == cursor->pos)
+	{
+		cursor->left_nxt += compword_to_int8(cursor->liptr);
+		cursor->liptr += int8compstoragesize(cursor->liptr);
+		cursor->i++;
+	}
+	while (cursor->right_nxt == cursor->pos)
+	{
+		cursor->right_nxt += compword_to_int8(cursor->riptr);
+		cursor->riptr += int8compstoragesize(cursor->riptr);
+		cursor->j++;
+	}
+	nextpos = Min(cursor->left_nxt,cursor->right_nxt);
+	cursor->run_length = nextpos - cursor->pos;
+	cursor->pos = nextpos;
+	return true;
+}
+
+/* Computes the dot product of two SparseData of float8s without
+ * materializing their element-wise product
+ */
+static inline double sdata_dot_double(SparseData left, SparseData right)
+{
+	double *lvals = (double *)left->vals->data;
+	double *rvals = (double *)right->vals->data;
+	double accum = 0.;
+	SparseDataPairCursor cursor;
+
+	if (SDATA_IS_UNCOMPRESSED(left) && SDATA_IS_UNCOMPRESSED(right))
+	{
+		check_sdata_dimensions(left,right);
+		for (int k=0; k<left->total_value_count; k++)
+			accum += lvals[k]*rvals[k];
+		return accum;
+	}
+
+	sdata_pair_cursor_init(&cursor,left,right);
+	while (sdata_pair_cursor_next(&cursor))
+		accum += lvals[cursor.i]*rvals[cursor.j]*cursor.run_length;
+	return accum;
+}
+
+/* Computes the l2 norm of the difference of two SparseData of float8s
+ * without materializing the difference
+ */
+static inline double sdata_l2dist_double(SparseData left, SparseData right)
+{
+	double *lvals = (double *)left->vals->data;
+	double *rvals = (double *)right->vals->data;
+	double accum = 0.;
+	double diff;
+	SparseDataPairCursor cursor;
+
+	if (SDATA_IS_UNCOMPRESSED(left) && SDATA_IS_UNCOMPRESSED(right))
+	{
+		check_sdata_dimensions(left,right);
+		for (int k=0; k<left->total_value_count; k++)
+		{
+			diff = lvals[k]-rvals[k];
+			accum += diff*diff;
+		}
+		return sqrt(accum);
+	}
+
+	sdata_pair_cursor_init(&cursor,left,right);
+	while (sdata_pair_cursor_next(&cursor))
+	{
+		diff = lvals[cursor.i]-rvals[cursor.j];
+		accum += diff*diff*cursor.run_length;
+	}
+	return sqrt(accum);
+}
+
 /*------------------------------------------------------------------------------
  * macros that will test whether a given double value is in the normal 
  * range or is in the special range (denormals, exceptions).
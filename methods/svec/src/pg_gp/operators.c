@@ -17,6 +17,8 @@
 #include "utils/builtins.h"
 #include "utils/memutils.h"
 #include "access/hash.h"
+#include "utils/lsyscache.h"
+#include "nodes/execnodes.h"
 
 #include "sparse_vector.h"
 
@@ -187,7 +189,53 @@ Datum svec_proj(PG_FUNCTION_ARGS)
 
 	if (IS_NVP(ret)) PG_RETURN_NULL();
 
-	PG_RETURN_FLOAT8(sd_proj(in,idx));
+	PG_RETURN_FLOAT8(ret);
+}
+
+/**
+ *  svec_proj_array - projects onto several elements of an svec
+ *
+ *  Calling svec_proj() for every position walks the run-length index from
+ *  the start every time, which is quadratic in the number of runs. Here, the
+ *  index is decoded only once, and every position is then found by binary
+ *  search. Elements that are NVPs are returned as NULL.
+ */
+Datum svec_proj_array(PG_FUNCTION_ARGS);
+PG_FUNCTION_INFO_V1( svec_proj_array );
+Datum svec_proj_array(PG_FUNCTION_ARGS) 
+{
+	SvecType * sv = PG_GETARG_SVECTYPE_P(0);
+	ArrayType *positions = PG_GETARG_ARRAYTYPE_P(1);
+	SparseData in = sdata_from_svec(sv);
+	int64 *run_ends;
+	int32 *idx;
+	int count, lbound = 1;
+	double *values;
+	bool *nulls;
+	ArrayType *result;
+
+	if (ARR_NDIM(positions) > 1 || ARR_HASNULL(positions))
+		ereport(ERROR,
+			(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+			 errmsg("svec_proj_array: positions must be a one-dimensional array without NULLs")));
+	count = (ARR_NDIM(positions) == 1) ? ARR_DIMS(positions)[0] : 0;
+	idx = (int32 *)ARR_DATA_PTR(positions);
+
+	run_ends = sdata_index_to_run_ends(in);
+	values = (double *)palloc(sizeof(double)*(count + 1));
+	nulls = (bool *)palloc(sizeof(bool)*(count + 1));
+	for (int i=0; i<count; i++)
+	{
+		values[i] = sd_proj_decoded(in,run_ends,idx[i]);
+		nulls[i] = IS_NVP(values[i]);
+	}
+
+	result = construct_md_array((Datum *)values, nulls, 1, &count, &lbound,
+				    FLOAT8OID, sizeof(float8), true, 'd');
+	pfree(run_ends);
+	pfree(values);
+	pfree(nulls);
+	PG_RETURN_ARRAYTYPE_P(result);
 }
 
 /**
@@ -584,52 +632,66 @@ Datum svec_count(PG_FUNCTION_ARGS)
 	SvecType * svec2 = PG_GETARG_SVECTYPE_P(1);
 	SparseData left = sdata_from_svec(svec1);
 	SparseData right = sdata_from_svec(svec2);
-
-	if (IS_SCALAR(svec1)) {
-		/*
-		 * If the left argument is {1}:{0}, this is the first call to 
-		 * the routine, and we need a zero vector for the beginning 
-		 * of the accumulation of the correct dimension.
-		 */
-		double * left_vals = (double *)(left->vals->data);
-		if (left_vals[0] == 0)
-			left = makeSparseDataFromDouble(0.,right->total_value_count);
-	} 
-	double *right_vals=(double *)(right->vals->data);
+	double *left_vals = (double *)(left->vals->data);
+	double *right_vals = (double *)(right->vals->data);
+	bool zero_start = false;
+	SparseDataPairCursor cursor;
+	SparseData sdata_result;
 	SvecType *result;
-	double *clamped_vals;
-	SparseData right_clamped,sdata_result;
+	double new_value, last_new_value = 0.;
+	int64 tot_run_length = -1;
+
+	/*
+	 * If the left argument is {1}:{0}, this is the first call to the
+	 * routine, and the accumulation starts from a zero vector of the
+	 * dimension of the right argument. We then walk the right argument
+	 * against itself instead of creating that zero vector.
+	 */
+	if (IS_SCALAR(svec1) && left_vals[0] == 0)
+	{
+		zero_start = true;
+		left = right;
+	}
 
 	if (left->total_value_count != right->total_value_count)
 		ereport(ERROR,
 			(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
 			 errmsg("Array dimension of inputs are not the same: dim1=%d, dim2=%d\n",
 				left->total_value_count, right->total_value_count)));
-	
-	/* Create an array of values either 1 or 0 depending on whether
-	 * the right vector has a non-zero value in it
+
+	/*
+	 * Add 1 to the left value wherever the right vector has a non-zero
+	 * value, and append a new run whenever the sum changes
 	 */
-	clamped_vals =
-		(double *)palloc0(sizeof(double)*(right->unique_value_count));
-		
-	for (int i=0;i<(right->unique_value_count);i++)
+	sdata_result = makeSparseData();
+	sdata_pair_cursor_init(&cursor,left,right);
+	while (sdata_pair_cursor_next(&cursor))
 	{
-		if (right_vals[i] != 0. && !IS_NVP(right_vals[i])) 
-			clamped_vals[i] = 1.;
+		new_value = zero_start ? 0. : left_vals[cursor.i];
+		if (right_vals[cursor.j] != 0. && !IS_NVP(right_vals[cursor.j]))
+			new_value += 1.;
+
+		if (tot_run_length == -1)
+		{
+			last_new_value = new_value;
+			tot_run_length = 0;
+		}
+		if (memcmp(&new_value,&last_new_value,sizeof(float8)))
+		{
+			add_run_to_sdata((char *)&last_new_value,tot_run_length,
+					 sizeof(float8),sdata_result);
+			tot_run_length = 0;
+			last_new_value = new_value;
+		}
+		tot_run_length += cursor.run_length;
 	}
-	right_clamped = makeInplaceSparseData(
-			     (char *)clamped_vals,right->index->data,
-			     right->vals->len,right->index->len,FLOAT8OID,
-			     right->unique_value_count,
-			     right->total_value_count);
+	if (tot_run_length > 0)
+		add_run_to_sdata((char *)&last_new_value,tot_run_length,
+				 sizeof(float8),sdata_result);
 
 	/* Create the output SVEC */
-	sdata_result = op_sdata_by_sdata(add,left,right_clamped);
 	result = svec_from_sparsedata(sdata_result,true);
-		
-	pfree(clamped_vals);
-	pfree(right_clamped);
-		
+
 	PG_RETURN_SVECTYPE_P(result);
 }
 
@@ -643,13 +705,10 @@ Datum svec_dot(PG_FUNCTION_ARGS)
 	SvecType *svec2 = PG_GETARG_SVECTYPE_P(1);
 	SparseData left  = sdata_from_svec(svec1);
 	SparseData right = sdata_from_svec(svec2);
-	SparseData mult_result;
 	double accum;
 	check_dimension(svec1,svec2,"svec_dot");
 
-	mult_result = op_sdata_by_sdata(multiply,left,right);
-	accum = sum_sdata_values_double(mult_result);
-	freeSparseDataAndData(mult_result);
+	accum = sdata_dot_double(left,right);
 
 	if (IS_NVP(accum)) PG_RETURN_NULL();
 
@@ -672,6 +731,27 @@ Datum svec_l2norm(PG_FUNCTION_ARGS)
 	PG_RETURN_FLOAT8(accum);
 }
 
+PG_FUNCTION_INFO_V1( svec_l2dist );
+/**
+ *  svec_l2dist - computes the l2 norm of the difference of two svecs,
+ *                without creating the difference
+ */
+Datum svec_l2dist(PG_FUNCTION_ARGS)
+{
+	SvecType *svec1 = PG_GETARG_SVECTYPE_P(0);
+	SvecType *svec2 = PG_GETARG_SVECTYPE_P(1);
+	SparseData left  = sdata_from_svec(svec1);
+	SparseData right = sdata_from_svec(svec2);
+	double accum;
+	check_dimension(svec1,svec2,"svec_l2dist");
+
+	accum = sdata_l2dist_double(left,right);
+
+	if (IS_NVP(accum)) PG_RETURN_NULL();
+
+	PG_RETURN_FLOAT8(accum);
+}
+
 PG_FUNCTION_INFO_V1( svec_l1norm );
 /**
  *  svec_l1norm - computes the l1 norm of an svec
@@ -1838,3 +1918,484 @@ Datum svec_hash( PG_FUNCTION_ARGS)
 	PG_RETURN_INT32(hash);
 }
 
+
+/*
+ * Aggregates svec_sum() and svec_mean()
+ *
+ * Calling svec_plus() for every row creates a new SparseData and serializes
+ * it into a new svec, i.e., the whole state is rewritten for every row. The
+ * functions below instead accumulate into a float8 array. Its first element
+ * is the number of rows, and its second one is the dimension d. The layout of
+ * the rest depends on the first row:
+ *
+ * - If the first row is dense (see sdata_is_dense()), the state holds d sums,
+ *   which the transition function modifies in place.
+ * - Otherwise, the dimension is stored negated, and the state holds the sum
+ *   as pairs of run length and value. Every row is then added with
+ *   op_sdata_by_sdata(), so that the state only takes space for the runs of
+ *   the sum, not for all d elements. Once the sum becomes dense, the state is
+ *   expanded.
+ *
+ * The array is converted into an svec only by the final functions. The
+ * initial state is an empty array.
+ */
+
+/* Checks that a destructive update of the state is safe */
+static void check_agg_context(FunctionCallInfo fcinfo)
+{
+	if (!(fcinfo->context && IsA(fcinfo->context, AggState)))
+		elog(ERROR, "destructive pass by reference outside agg");
+}
+
+/* Returns the number of elements of an accumulator array */
+static int svec_accum_size(ArrayType *accum)
+{
+	if (ARR_NDIM(accum) == 0)
+		return 0;
+	if (ARR_NDIM(accum) != 1 || ARR_HASNULL(accum) || ARR_DIMS(accum)[0] < 2)
+		ereport(ERROR,
+			(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+			 errmsg("invalid svec accumulator")));
+	return ARR_DIMS(accum)[0];
+}
+
+/* Returns true if the accumulator holds the runs of the sum */
+static inline bool svec_accum_is_sparse(ArrayType *accum)
+{
+	return ((double *)ARR_DATA_PTR(accum))[1] < 0;
+}
+
+/* Checks that an svec of the given dimension can be added to an accumulator */
+static void svec_accum_check_dimension(ArrayType *accum, int dimension)
+{
+	int accum_dimension = (int) fabs(((double *)ARR_DATA_PTR(accum))[1]);
+
+	if (accum_dimension != dimension)
+		ereport(ERROR,
+			(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+			 errmsg("svec_sum: array dimension of inputs are not the same: dim1=%d, dim2=%d",
+				accum_dimension, dimension)));
+}
+
+/* Returns a dense accumulator holding the given sum of count rows */
+static ArrayType *svec_accum_make_dense(SparseData sum, double count)
+{
+	int dimension = sum->total_value_count;
+	double *state = (double *)palloc(sizeof(double)*(dimension + 2));
+	double *sums = sdata_to_float8arr(sum);
+	ArrayType *accum;
+
+	state[0] = count;
+	state[1] = dimension;
+	memcpy(state + 2, sums, sizeof(double)*dimension);
+	accum = construct_array((Datum *)state, dimension + 2,
+				FLOAT8OID, sizeof(float8), true, 'd');
+	pfree(sums);
+	pfree(state);
+	return accum;
+}
+
+/* Returns an accumulator holding the given sum of count rows, as runs
+ * unless the sum is dense
+ */
+static ArrayType *svec_accum_make(SparseData sum, double count)
+{
+	int size = 2 + 2*sum->unique_value_count;
+	double *vals = (double *)sum->vals->data;
+	char *ix = sum->index->data;
+	double *state;
+	ArrayType *accum;
+
+	if (sdata_is_dense(sum))
+		return svec_accum_make_dense(sum, count);
+
+	state = (double *)palloc(sizeof(double)*size);
+	state[0] = count;
+	state[1] = -(double) sum->total_value_count;
+	for (int i=0; i<sum->unique_value_count; i++)
+	{
+		state[2 + 2*i] = compword_to_int8(ix);
+		state[3 + 2*i] = vals[i];
+		ix += int8compstoragesize(ix);
+	}
+	accum = construct_array((Datum *)state, size,
+				FLOAT8OID, sizeof(float8), true, 'd');
+	pfree(state);
+	return accum;
+}
+
+/* Returns the sum held by an accumulator of either layout */
+static SparseData svec_accum_to_sdata(ArrayType *accum)
+{
+	int size = svec_accum_size(accum);
+	double *state = (double *)ARR_DATA_PTR(accum);
+	SparseData sum;
+
+	if (!svec_accum_is_sparse(accum))
+		return float8arr_to_sdata(state + 2, size - 2);
+
+	sum = makeSparseData();
+	for (int k=2; k+1<size; k+=2)
+		add_run_to_sdata((char *)(&state[k + 1]), (int64) state[k],
+				 sizeof(float8), sum);
+	return sum;
+}
+
+/* Adds the sum in sdata to the sums of a dense accumulator, in place.
+ * Runs of zeros (usually most of a sparse vector) are skipped.
+ */
+static void svec_accum_add_dense(ArrayType *accum, SparseData sdata)
+{
+	double *sums = (double *)ARR_DATA_PTR(accum) + 2;
+	double *vals = (double *)sdata->vals->data;
+	char *ix = sdata->index->data;
+	int64 pos = 0, run_length;
+
+	for (int i=0; i<sdata->unique_value_count; i++)
+	{
+		run_length = compword_to_int8(ix);
+		if (vals[i] != 0.)
+			for (int64 k=pos; k<pos+run_length; k++)
+				sums[k] += vals[i];
+		pos += run_length;
+		ix += int8compstoragesize(ix);
+	}
+}
+
+PG_FUNCTION_INFO_V1( svec_sum_transition );
+/**
+ *  svec_sum_transition - adds an svec to an accumulator array, in place if
+ *                        the accumulator is dense
+ */
+Datum svec_sum_transition(PG_FUNCTION_ARGS)
+{
+	ArrayType *accum = PG_GETARG_ARRAYTYPE_P(0);
+	SvecType *svec = PG_GETARG_SVECTYPE_P(1);
+	SparseData sdata = sdata_from_svec(svec);
+	int size = svec_accum_size(accum);
+	double count;
+	SparseData sum;
+
+	check_agg_context(fcinfo);
+
+	if (size == 0)
+		PG_RETURN_ARRAYTYPE_P(svec_accum_make(sdata, 1.));
+
+	svec_accum_check_dimension(accum, sdata->total_value_count);
+	count = ((double *)ARR_DATA_PTR(accum))[0] + 1.;
+
+	if (svec_accum_is_sparse(accum))
+	{
+		sum = op_sdata_by_sdata(add, svec_accum_to_sdata(accum), sdata);
+		PG_RETURN_ARRAYTYPE_P(svec_accum_make(sum, count));
+	}
+
+	svec_accum_add_dense(accum, sdata);
+	((double *)ARR_DATA_PTR(accum))[0] = count;
+	PG_RETURN_ARRAYTYPE_P(accum);
+}
+
+PG_FUNCTION_INFO_V1( svec_sum_merge );
+/**
+ *  svec_sum_merge - adds two accumulator arrays; a dense left one is modified
+ *                   in place if called as part of an aggregate
+ */
+Datum svec_sum_merge(PG_FUNCTION_ARGS)
+{
+	ArrayType *left = PG_GETARG_ARRAYTYPE_P(0);
+	ArrayType *right = PG_GETARG_ARRAYTYPE_P(1);
+	int lsize = svec_accum_size(left);
+	int rsize = svec_accum_size(right);
+	double count;
+	ArrayType *tmp;
+	SparseData rsum;
+
+	if (rsize == 0)
+		PG_RETURN_ARRAYTYPE_P(left);
+	if (lsize == 0)
+		PG_RETURN_ARRAYTYPE_P(right);
+	svec_accum_check_dimension(left,
+		(int) fabs(((double *)ARR_DATA_PTR(right))[1]));
+	count = ((double *)ARR_DATA_PTR(left))[0]
+		+ ((double *)ARR_DATA_PTR(right))[0];
+
+	if (svec_accum_is_sparse(left) && svec_accum_is_sparse(right))
+		PG_RETURN_ARRAYTYPE_P(svec_accum_make(
+			op_sdata_by_sdata(add, svec_accum_to_sdata(left),
+					  svec_accum_to_sdata(right)), count));
+
+	/* At least one side is dense, and we add into that one */
+	if (svec_accum_is_sparse(left))
+	{
+		tmp = left;
+		left = right;
+		right = tmp;
+	}
+	if (!(fcinfo->context && IsA(fcinfo->context, AggState))
+	    || left != PG_GETARG_ARRAYTYPE_P(0))
+	{
+		tmp = (ArrayType *)palloc(VARSIZE(left));
+		memcpy(tmp, left, VARSIZE(left));
+		left = tmp;
+	}
+
+	rsum = svec_accum_to_sdata(right);
+	svec_accum_add_dense(left, rsum);
+	((double *)ARR_DATA_PTR(left))[0] = count;
+	PG_RETURN_ARRAYTYPE_P(left);
+}
+
+PG_FUNCTION_INFO_V1( svec_sum_final );
+/**
+ *  svec_sum_final - converts an accumulator array into the sum svec
+ */
+Datum svec_sum_final(PG_FUNCTION_ARGS)
+{
+	ArrayType *accum = PG_GETARG_ARRAYTYPE_P(0);
+	int size = svec_accum_size(accum);
+
+	/* Like svec_plus() with initial value 0, the sum of no rows is 0 */
+	if (size == 0)
+		PG_RETURN_SVECTYPE_P(svec_make_scalar(0.));
+
+	if (svec_accum_is_sparse(accum))
+		PG_RETURN_SVECTYPE_P(svec_from_sparsedata(
+			svec_accum_to_sdata(accum), true));
+
+	PG_RETURN_SVECTYPE_P(svec_from_float8arr(
+		(double *)ARR_DATA_PTR(accum) + 2, size - 2));
+}
+
+PG_FUNCTION_INFO_V1( svec_mean_final );
+/**
+ *  svec_mean_final - converts an accumulator array into the mean svec
+ */
+Datum svec_mean_final(PG_FUNCTION_ARGS)
+{
+	ArrayType *accum = PG_GETARG_ARRAYTYPE_P(0);
+	int size = svec_accum_size(accum);
+	double *sums, *means, count;
+	SparseData sum;
+	SvecType *result;
+
+	if (size == 0)
+		PG_RETURN_NULL();
+
+	sums = (double *)ARR_DATA_PTR(accum);
+	count = sums[0];
+
+	if (svec_accum_is_sparse(accum))
+	{
+		sum = svec_accum_to_sdata(accum);
+		op_sdata_by_scalar_inplace(divide, (char *)&count, sum, true);
+		PG_RETURN_SVECTYPE_P(svec_from_sparsedata(sum, true));
+	}
+
+	means = (double *)palloc(sizeof(double)*(size - 2));
+	for (int k=0; k<size - 2; k++)
+		means[k] = sums[k + 2] / count;
+
+	result = svec_from_float8arr(means, size - 2);
+	pfree(means);
+	PG_RETURN_SVECTYPE_P(result);
+}
+
+/*
+ * Nearest centroids: svec_closest() and svec_closest_k()
+ *
+ * k-means assigns every point to its closest centroid, passing the same
+ * array of centroids with every point. The centroids are therefore decoded
+ * only once per call site and kept in fn_extra, together with their squared
+ * norms. The distance ||p - c||^2 = ||p||^2 - 2 p.c + ||c||^2 then only needs
+ * the dot product p.c, which does not allocate. Since ||p||^2 is the same for
+ * all centroids, it is left out when ranking them.
+ */
+typedef struct {
+	MemoryContext mcxt;   /**< Child of fn_mcxt holding all of the below */
+	struct varlena *key;  /**< Copy of the (possibly toasted) array argument */
+	int num_centroids;    /**< Number of elements of the array */
+	int lbound;           /**< Lower bound of the array */
+	SvecType *first;      /**< First non-NULL centroid, for dimension checks */
+	SparseData *sdata;    /**< Decoded centroids, NULL for NULL elements */
+	double *sq_norms;     /**< Squared l2 norms of the centroids */
+} SvecCentroidsCache;
+
+/*
+ * Returns the decoded centroids of the svec[] argument argno, decoding them
+ * only if the argument differs from that of the previous call. As for
+ * sdata_from_svec_cached(), arguments are compared by content. We compare the
+ * raw datum, so that an array stored out of line is identified by its toast
+ * pointer and not detoasted for every call.
+ */
+static SvecCentroidsCache *centroids_cached(FunctionCallInfo fcinfo, int argno)
+{
+	SvecCentroidsCache *cache = (SvecCentroidsCache *) fcinfo->flinfo->fn_extra;
+	struct varlena *key = (struct varlena *) DatumGetPointer(PG_GETARG_DATUM(argno));
+	MemoryContext oldcontext;
+	ArrayType *array;
+	Datum *elems;
+	bool *nulls;
+	int16 typlen;
+	bool typbyval;
+	char typalign;
+	SvecType *svec;
+
+	if (cache == NULL) {
+		cache = (SvecCentroidsCache *) MemoryContextAllocZero(
+			fcinfo->flinfo->fn_mcxt, sizeof(SvecCentroidsCache));
+		cache->mcxt = AllocSetContextCreate(fcinfo->flinfo->fn_mcxt,
+			"svec_closest centroids",
+			ALLOCSET_DEFAULT_MINSIZE,
+			ALLOCSET_DEFAULT_INITSIZE,
+			ALLOCSET_DEFAULT_MAXSIZE);
+		fcinfo->flinfo->fn_extra = cache;
+	}
+
+	if (cache->key != NULL && VARSIZE_ANY(cache->key) == VARSIZE_ANY(key) &&
+	    memcmp(cache->key, key, VARSIZE_ANY(key)) == 0)
+		return cache;
+
+	/* Free everything of the previous argument. The key is only set once
+	 * the new centroids are complete, so an error below cannot leave a
+	 * half-built cache behind. */
+	cache->key = NULL;
+	MemoryContextReset(cache->mcxt);
+	oldcontext = MemoryContextSwitchTo(cache->mcxt);
+
+	array = DatumGetArrayTypePCopy(PG_GETARG_DATUM(argno));
+	if (ARR_NDIM(array) > 1)
+		ereport(ERROR,
+			(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+			 errmsg("svec_closest: centroids must be a one-dimensional array")));
+	get_typlenbyvalalign(ARR_ELEMTYPE(array), &typlen, &typbyval, &typalign);
+	deconstruct_array(array, ARR_ELEMTYPE(array), typlen, typbyval, typalign,
+			  &elems, &nulls, &cache->num_centroids);
+	cache->lbound = (ARR_NDIM(array) == 1) ? ARR_LBOUND(array)[0] : 1;
+	cache->first = NULL;
+	cache->sdata = (SparseData *) palloc(sizeof(SparseData)*(cache->num_centroids + 1));
+	cache->sq_norms = (double *) palloc(sizeof(double)*(cache->num_centroids + 1));
+
+	for (int c=0; c<cache->num_centroids; c++)
+	{
+		cache->sdata[c] = NULL;
+		if (nulls[c])
+			continue;
+		svec = (SvecType *) PG_DETOAST_DATUM(elems[c]);
+		if (cache->first == NULL)
+			cache->first = svec;
+		else
+			check_dimension(cache->first, svec, "svec_closest");
+		cache->sdata[c] = sdata_from_svec(svec);
+		cache->sq_norms[c] =
+			accum_sdata_values_double(cache->sdata[c], square);
+	}
+
+	cache->key = (struct varlena *) palloc(VARSIZE_ANY(key));
+	memcpy(cache->key, key, VARSIZE_ANY(key));
+
+	MemoryContextSwitchTo(oldcontext);
+	return cache;
+}
+
+/*
+ * Returns ||c||^2 - 2 p.c for centroid c, i.e., the squared distance between
+ * the point and c minus ||p||^2. NULL centroids and NVPs yield NaN.
+ */
+static inline double centroid_score(SvecCentroidsCache *cache, int c,
+				    SparseData point)
+{
+	if (cache->sdata[c] == NULL)
+		return NVP;
+	return cache->sq_norms[c] - 2. * sdata_dot_double(point, cache->sdata[c]);
+}
+
+PG_FUNCTION_INFO_V1( svec_closest );
+/**
+ *  svec_closest - returns the array index of the centroid closest to a point,
+ *                 or NULL if there is none. Ties go to the lower index.
+ */
+Datum svec_closest(PG_FUNCTION_ARGS)
+{
+	SvecType *svec = PG_GETARG_SVECTYPE_P(0);
+	SvecCentroidsCache *cache = centroids_cached(fcinfo, 1);
+	SparseData point;
+	double score, min_score = 0.;
+	int closest = -1;
+
+	if (cache->first == NULL)
+		PG_RETURN_NULL();
+	check_dimension(svec, cache->first, "svec_closest");
+	point = sdata_from_svec(svec);
+
+	for (int c=0; c<cache->num_centroids; c++)
+	{
+		score = centroid_score(cache, c, point);
+		if (isnan(score))
+			continue;
+		if (closest < 0 || score < min_score)
+		{
+			min_score = score;
+			closest = c;
+		}
+	}
+
+	if (closest < 0)
+		PG_RETURN_NULL();
+	PG_RETURN_INT32(cache->lbound + closest);
+}
+
+PG_FUNCTION_INFO_V1( svec_closest_k );
+/**
+ *  svec_closest_k - returns the array indices of the k centroids closest to
+ *                   a point, closest first. Fewer than k indices are returned
+ *                   if there are fewer (non-NULL) centroids.
+ */
+Datum svec_closest_k(PG_FUNCTION_ARGS)
+{
+	SvecType *svec = PG_GETARG_SVECTYPE_P(0);
+	SvecCentroidsCache *cache = centroids_cached(fcinfo, 1);
+	int k = PG_GETARG_INT32(2);
+	SparseData point;
+	double score;
+	double *scores;
+	int32 *closest;
+	int num_closest = 0;
+	int pos;
+	ArrayType *result;
+
+	if (k <= 0)
+		ereport(ERROR,
+			(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+			 errmsg("svec_closest_k: k must be positive")));
+	if (cache->first != NULL)
+		check_dimension(svec, cache->first, "svec_closest_k");
+	k = Min(k, cache->num_centroids);
+	point = sdata_from_svec(svec);
+
+	/* Insertion into the sorted list of the k best centroids so far. Ties go
+	 * to the lower index. */
+	scores = (double *) palloc(sizeof(double)*(k + 1));
+	closest = (int32 *) palloc(sizeof(int32)*(k + 1));
+	for (int c=0; c<cache->num_centroids; c++)
+	{
+		score = centroid_score(cache, c, point);
+		if (isnan(score))
+			continue;
+		if (num_closest == k && score >= scores[k - 1])
+			continue;
+		pos = (num_closest < k) ? num_closest++ : k - 1;
+		for (; pos > 0 && score < scores[pos - 1]; pos--)
+		{
+			scores[pos] = scores[pos - 1];
+			closest[pos] = closest[pos - 1];
+		}
+		scores[pos] = score;
+		closest[pos] = cache->lbound + c;
+	}
+
+	result = construct_array((Datum *)closest, num_closest, INT4OID,
+				 sizeof(int32), true, 'i');
+	pfree(scores);
+	pfree(closest);
+	PG_RETURN_ARRAYTYPE_P(result);
+}
@@ -0,0 +1,150 @@
+/* ----------------------------------------------------------------------- *//**
+ *
+ * @file BenchInterface.hpp
+ *
+ * @brief Database interface for running the core library without a DBMS
+ *
+ *//* ----------------------------------------------------------------------- */
+
+#ifndef MADLIB_BENCH_BENCHINTERFACE_HPP
+#define MADLIB_BENCH_BENCHINTERFACE_HPP
+
+#define BOOST_ENABLE_ASSERT_HANDLER
+
+#include <dbal/dbal.hpp>
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+namespace madlib {
+
+/**
+ * @brief Micro-benchmarks for the core library
+ */
+namespace bench {
+
+using namespace dbal;
+
+/**
+ * @brief Counters for all heap allocations (operator new and BenchAllocator)
+ */
+struct AllocationCounter {
+    static uint64_t sNumAllocations;
+    static uint64_t sNumBytes;
+
+    static void reset() {
+        sNumAllocations = 0;
+        sNumBytes = 0;
+    }
+
+    static void *allocate(std::size_t inSize) {
+        sNumAllocations++;
+        sNumBytes += inSize;
+        return std::malloc(inSize);
+    }
+};
+
+/**
+ * @brief Handle to a heap-allocated block of memory, owned by the handle
+ */
+class BenchArrayHandle : public AbstractHandle {
+public:
+    BenchArrayHandle(std::size_t inSize)
+        : mPtr(AllocationCounter::allocate(inSize)), mSize(inSize) {
+
+        if (mPtr == NULL)
+            throw std::bad_alloc();
+        std::memset(mPtr, 0, inSize);
+    }
+
+    ~BenchArrayHandle() {
+        std::free(mPtr);
+    }
+
+    void *ptr() {
+        return mPtr;
+    }
+
+    MemHandleSPtr clone() const {
+        BenchArrayHandle *handle = new BenchArrayHandle(mSize);
+        std::memcpy(handle->mPtr, mPtr, mSize);
+        return MemHandleSPtr(handle);
+    }
+
+protected:
+    void *mPtr;
+    std::size_t mSize;
+};
+
+/**
+ * @brief Allocator for benchmarks
+ *
+ * All memory is taken from the C heap, and every allocation is counted. There
+ * is no difference between the function and the aggregate context.
+ */
+class BenchAllocator : public AbstractAllocator {
+public:
+    MemHandleSPtr allocateArray(uint32_t inNumElements,
+        double * /* ignored */) const {
+
+        return MemHandleSPtr(
+            new BenchArrayHandle(inNumElements * sizeof(double)));
+    }
+
+    void *allocate(const uint32_t inSize) const throw(std::bad_alloc) {
+        void *ptr = AllocationCounter::allocate(inSize);
+        if (ptr == NULL)
+            throw std::bad_alloc();
+        return ptr;
+    }
+
+    void *allocate(const uint32_t inSize, const std::nothrow_t&) const
+        throw() {
+
+        return AllocationCounter::allocate(inSize);
+    }
+
+    void free(void *inPtr) const throw() {
+        std::free(inPtr);
+    }
+};
+
+/**
+ * @brief Database interface for benchmarks, writing all output to stderr
+ */
+class BenchInterface : public AbstractDBInterface {
+public:
+    BenchInterface()
+    :   AbstractDBInterface(
+            new BenchOutputStreamBuffer(),
+            new BenchOutputStreamBuffer()) {
+
+        arma::set_log_stream(mArmadilloOut);
+    }
+
+    ~BenchInterface() {
+        delete out.rdbuf();
+        delete err.rdbuf();
+    }
+
+    AllocatorSPtr allocator(
+        AbstractAllocator::Context /* inMemContext */) {
+
+        return AllocatorSPtr(new BenchAllocator);
+    }
+
+private:
+    class BenchOutputStreamBuffer : public AbstractOutputStreamBuffer<char> {
+    public:
+        void output(char *inMsg, uint32_t /* inLength */) {
+            std::cerr << inMsg;
+        }
+    };
+};
+
+} // namespace bench
+
+} // namespace madlib
+
+#endif
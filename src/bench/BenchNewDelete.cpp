@@ -0,0 +1,39 @@
+/* ----------------------------------------------------------------------- *//**
+ *
+ * @file BenchNewDelete.cpp
+ *
+ * @brief Overloading operator new and operator delete to count allocations
+ *
+ *//* ----------------------------------------------------------------------- */
+
+#include "BenchInterface.hpp"
+
+using madlib::bench::AllocationCounter;
+
+uint64_t AllocationCounter::sNumAllocations = 0;
+uint64_t AllocationCounter::sNumBytes = 0;
+
+/*
+ * As in ports/postgres/dbconnector/PGNewDelete.cpp, we override the global
+ * storage allocation and deallocation functions. The array variants call the
+ * non-array variants by default (18.4.1.2).
+ */
+
+void *operator new(std::size_t size) throw (std::bad_alloc) {
+    void *ptr = AllocationCounter::allocate(size);
+    if (ptr == NULL)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void operator delete(void *ptr) throw() {
+    std::free(ptr);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) throw() {
+    return AllocationCounter::allocate(size);
+}
+
+void operator delete(void *ptr, const std::nothrow_t&) throw() {
+    std::free(ptr);
+}
@@ -0,0 +1,462 @@
+/* ----------------------------------------------------------------------- *//**
+ *
+ * @file bench.cpp
+ *
+ * @brief Micro-benchmarks for the MADlib core library
+ *
+ * Every benchmark calls a UDF implementation in a loop, in the same way a
+ * connector would (i.e., including the construction of the argument list), and
+ * reports throughput (rows per second and nanoseconds per row) and the number
+ * of heap allocations per call. The first call of each benchmark is excluded
+ * because it needs to allocate the transition state.
+ *
+ * We cover the transition functions of linear regression and of both
+ * logistic-regression solvers (conjugate gradient and IRLS), each via the
+ * generic interface and via the in-place fast path, as well as the Student-t
+ * and chi-squared distribution functions.
+ *
+ *//* ----------------------------------------------------------------------- */
+
+#include "BenchInterface.hpp"
+
+#include <modules/prob/prob.hpp>
+#include <modules/regress/linear.hpp>
+#include <modules/regress/logistic.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <sys/time.h>
+
+namespace madlib {
+
+namespace bench {
+
+using modules::prob::chi_squared_cdf;
+using modules::prob::chi_squared_cdf_array;
+using modules::prob::student_t_cdf;
+using modules::prob::student_t_cdf_array;
+using modules::prob::studentT_cdf_ibeta;
+using modules::prob::studentT_cdf_series;
+using modules::regress::LinearRegression;
+using modules::regress::LogisticRegressionCG;
+using modules::regress::LogisticRegressionIRLS;
+
+/**
+ * @brief Deterministic pseudo-random design matrix
+ *
+ * We use a simple linear congruential generator, so that results are
+ * reproducible across platforms.
+ */
+class DesignMatrix {
+public:
+    DesignMatrix(uint16_t inWidth, uint32_t inNumRows)
+        : mWidth(inWidth), mNumRows(inNumRows), mX(inWidth * inNumRows),
+          mY(inNumRows) {
+
+        uint64_t seed = 42;
+        for (uint32_t row = 0; row < inNumRows; row++) {
+            mX[row * inWidth] = 1;
+            for (uint16_t col = 1; col < inWidth; col++)
+                mX[row * inWidth + col] = next(seed);
+            mY[row] = next(seed);
+        }
+    }
+
+    double *x(uint32_t inRow) { return &mX[(inRow % mNumRows) * mWidth]; }
+    double y(uint32_t inRow) const { return mY[inRow % mNumRows]; }
+    uint16_t width() const { return mWidth; }
+
+private:
+    static double next(uint64_t &ioSeed) {
+        ioSeed = ioSeed * 6364136223846793005ULL + 1442695040888963407ULL;
+        return static_cast<double>(ioSeed >> 11) / 9007199254740992.;
+    }
+
+    uint16_t mWidth;
+    uint32_t mNumRows;
+    std::vector<double> mX;
+    std::vector<double> mY;
+};
+
+inline RawArgument doubleArgument(double inValue) {
+    RawArgument arg = { RawArgument::kDouble };
+    arg.value.doubleValue = inValue;
+    return arg;
+}
+
+inline RawArgument boolArgument(bool inValue) {
+    RawArgument arg = { RawArgument::kBool };
+    arg.value.boolValue = inValue;
+    return arg;
+}
+
+inline RawArgument nullArgument() {
+    RawArgument arg = { RawArgument::kNull };
+    return arg;
+}
+
+inline RawArgument arrayArgument(double *inData, uint32_t inNumElements,
+    bool inIsMutable) {
+
+    RawArgument arg = { RawArgument::kDoubleArray };
+    arg.isMutable = inIsMutable;
+    arg.data = inData;
+    arg.numElements = inNumElements;
+    return arg;
+}
+
+/**
+ * @brief Describe a (mutable) transition state held by an AnyValue
+ */
+inline RawArgument stateArgument(const AnyValue &inState) {
+    Array<double> storage = inState;
+    return arrayArgument(storage.data(), storage.size(), true);
+}
+
+typedef AnyValue (UDF)(AbstractDBInterface &, AnyValue);
+typedef bool (InPlaceUDF)(const RawArgument *, uint16_t);
+
+/**
+ * @brief Description of an aggregate transition function
+ */
+struct Transition {
+    const char *name;
+    UDF *transition;
+    InPlaceUDF *transitionInPlace;
+
+    /**
+     * @brief Number of elements of the initial state (the INITCOND in SQL)
+     */
+    uint16_t initialStateSize;
+
+    /**
+     * @brief Whether the dependent variable is boolean and whether there is a
+     *        trailing argument for the state of the previous iteration (as for
+     *        logistic regression)
+     */
+    bool isLogistic;
+};
+
+/**
+ * @brief Return the current wall-clock time in seconds
+ */
+static double now() {
+    struct timeval time;
+
+    gettimeofday(&time, NULL);
+    return time.tv_sec + time.tv_usec * 1e-6;
+}
+
+/**
+ * @brief Reset all counters, at the beginning of the measured calls
+ */
+static double startMeasurement() {
+    AllocationCounter::reset();
+    return now();
+}
+
+/**
+ * @brief Report throughput and allocations per call
+ *
+ * @param inName Name of the benchmark
+ * @param inWidth Width of the design matrix (or, for scalar functions, any
+ *     other parameter worth reporting)
+ * @param inNumCalls Number of calls since startMeasurement()
+ * @param inStart Return value of startMeasurement()
+ */
+static void report(const char *inName, uint16_t inWidth, uint32_t inNumCalls,
+    double inStart) {
+
+    double seconds = now() - inStart;
+
+    std::printf("%-40s width %4u: %12.0f rows/s, %10.1f ns/row, "
+        "%8.2f allocations/row, %10.1f bytes/row\n",
+        inName, static_cast<unsigned int>(inWidth),
+        inNumCalls / seconds,
+        seconds * 1e9 / inNumCalls,
+        static_cast<double>(AllocationCounter::sNumAllocations) / inNumCalls,
+        static_cast<double>(AllocationCounter::sNumBytes) / inNumCalls);
+}
+
+/**
+ * @brief Call a transition function via the generic AnyValue interface
+ */
+static AnyValue callTransition(BenchInterface &db,
+    const Transition &inTransition, const AnyValue &inState,
+    DesignMatrix &inData, uint32_t inRow) {
+
+    AnyValueVector args;
+    ConcreteRecord::iterator arg(args);
+    arg++ = inState;
+    if (inTransition.isLogistic)
+        arg++ = inData.y(inRow) > 0.5;
+    else
+        arg++ = inData.y(inRow);
+    arg++ = DoubleRow_const(inData.x(inRow), inData.width());
+    if (inTransition.isLogistic)
+        arg++ = Null();
+    return inTransition.transition(db, args);
+}
+
+/**
+ * @brief Run a transition function over inNumRows rows
+ *
+ * @param inInPlace Whether to try the in-place function first, as
+ *     callInPlace() does. Otherwise, always use the generic interface, as
+ *     call() does.
+ */
+static AnyValue runTransition(const Transition &inTransition,
+    DesignMatrix &inData, uint32_t inNumRows, bool inInPlace) {
+
+    BenchInterface db;
+    std::vector<double> initialState(inTransition.initialStateSize, 0.);
+    AnyValue state = Array<double>(&initialState[0],
+        boost::extents[inTransition.initialStateSize]);
+    RawArgument stateArg = stateArgument(state);
+    double start = 0;
+
+    for (uint32_t row = 0; row < inNumRows; row++) {
+        if (row == 1)
+            start = startMeasurement();
+
+        if (inInPlace) {
+            RawArgument args[4] = {
+                stateArg,
+                doubleArgument(inData.y(row)),
+                arrayArgument(inData.x(row), inData.width(), false),
+                nullArgument()
+            };
+            if (inTransition.isLogistic)
+                args[1] = boolArgument(inData.y(row) > 0.5);
+
+            if (inTransition.transitionInPlace(args,
+                    inTransition.isLogistic ? 4 : 3))
+                continue;
+        }
+
+        state = callTransition(db, inTransition, state, inData, row);
+        stateArg = stateArgument(state);
+    }
+
+    std::string name = std::string(inTransition.name)
+        + (inInPlace ? " (in-place)" : " (generic)");
+    report(name.c_str(), inData.width(), inNumRows - 1, start);
+    return state;
+}
+
+/**
+ * @brief Return the maximum absolute difference between two states
+ */
+static double maxDifference(const Array<double> &inLeft,
+    const Array<double> &inRight) {
+
+    if (inLeft.size() != inRight.size())
+        return std::numeric_limits<double>::infinity();
+
+    double diff = 0;
+    for (uint32_t i = 0; i < inLeft.size(); i++)
+        diff = std::max(diff, std::fabs(inLeft[i] - inRight[i]));
+    return diff;
+}
+
+/**
+ * @brief Call a cumulative distribution function <tt>f(nu, t)</tt> via the
+ *        generic AnyValue interface
+ *
+ * The degree of freedom cycles through 1, ..., inMaxNu. The argument t is
+ * taken from the second column of the design matrix and lies in [-5, 5).
+ *
+ * @return The sum of all function values, which we print so that the compiler
+ *     cannot optimize the calls away
+ */
+static double runCDF(const char *inName, UDF *inCDF, DesignMatrix &inData,
+    uint32_t inNumRows, uint16_t inMaxNu) {
+
+    BenchInterface db;
+    double sum = 0;
+    double start = 0;
+
+    for (uint32_t row = 0; row < inNumRows; row++) {
+        if (row == 1)
+            start = startMeasurement();
+
+        AnyValueVector args;
+        ConcreteRecord::iterator arg(args);
+        arg++ = static_cast<int64_t>(1 + row % inMaxNu);
+        arg++ = 10. * inData.x(row)[1] - 5.;
+        double value = inCDF(db, args);
+        sum += value;
+    }
+    report(inName, inMaxNu, inNumRows - 1, start);
+    return sum;
+}
+
+/**
+ * @brief Call an array variant of a cumulative distribution function
+ *        <tt>f(nu, t[])</tt> via the generic AnyValue interface
+ *
+ * Same as runCDF(), except that each call evaluates kArraySize arguments.
+ * Throughput is reported per argument, so that the numbers are comparable to
+ * those of runCDF().
+ */
+static double runArrayCDF(const char *inName, UDF *inCDF, DesignMatrix &inData,
+    uint32_t inNumRows, uint16_t inMaxNu) {
+
+    enum { kArraySize = 100 };
+
+    BenchInterface db;
+    std::vector<double> tData(kArraySize);
+    uint32_t numCalls = std::max<uint32_t>(2, inNumRows / kArraySize);
+    double sum = 0;
+    double start = 0;
+
+    for (uint32_t call = 0; call < numCalls; call++) {
+        if (call == 1)
+            start = startMeasurement();
+
+        for (uint32_t i = 0; i < kArraySize; i++)
+            tData[i] = 10. * inData.x(call * kArraySize + i)[1] - 5.;
+
+        AnyValueVector args;
+        ConcreteRecord::iterator arg(args);
+        arg++ = static_cast<int64_t>(1 + call % inMaxNu);
+        arg++ = Array<double>(&tData[0], boost::extents[kArraySize]);
+        Array_const<double> values = inCDF(db, args);
+        for (uint32_t i = 0; i < kArraySize; i++)
+            sum += values[i];
+    }
+    report(inName, inMaxNu, (numCalls - 1) * kArraySize, start);
+    return sum;
+}
+
+typedef void (StudentTKernel)(int64_t, const double *, double *, uint32_t);
+
+/**
+ * @brief Call a Student-t CDF kernel directly (without the AnyValue
+ *        interface) for a fixed degree of freedom
+ *
+ * The arguments lie in [-5, 5) as for runCDF().
+ *
+ * @param outCDF Vector that the values of the last call are written to
+ */
+static void runStudentTKernel(const char *inName, StudentTKernel *inKernel,
+    DesignMatrix &inData, uint32_t inNumRows, int64_t inNu,
+    std::vector<double> &outCDF) {
+
+    enum { kArraySize = 1000 };
+
+    std::vector<double> t(kArraySize);
+    uint32_t numCalls = std::max<uint32_t>(2, inNumRows / kArraySize);
+    double start = 0;
+
+    for (uint32_t i = 0; i < kArraySize; i++)
+        t[i] = 10. * inData.x(i)[1] - 5.;
+    outCDF.resize(kArraySize);
+
+    for (uint32_t call = 0; call < numCalls; call++) {
+        if (call == 1)
+            start = startMeasurement();
+        inKernel(inNu, &t[0], &outCDF[0], kArraySize);
+    }
+    report(inName, static_cast<uint16_t>(std::min<int64_t>(inNu, 65535)),
+        (numCalls - 1) * kArraySize, start);
+}
+
+} // namespace bench
+
+} // namespace madlib
+
+/**
+ * @brief Run all benchmarks
+ *
+ * Usage: <tt>madlib_bench [num_rows [width ...]]</tt>. By default, 100000 rows
+ * are processed for each of the widths 4, 16, and 64. Rows are drawn
+ * (cyclically) from a synthetic design matrix with 1000 rows.
+ */
+int main(int argc, char *argv[]) {
+    using namespace madlib::bench;
+
+    uint32_t numRows = argc > 1 ? std::atoi(argv[1]) : 100000;
+    std::vector<uint16_t> widths;
+    for (int i = 2; i < argc; i++)
+        widths.push_back(std::atoi(argv[i]));
+    if (widths.empty()) {
+        widths.push_back(4);
+        widths.push_back(16);
+        widths.push_back(64);
+    }
+    if (numRows < 2 || std::find(widths.begin(), widths.end(), 0)
+            != widths.end()) {
+        std::fprintf(stderr, "Usage: %s [num_rows [width ...]]\n"
+            "num_rows must be at least 2, and widths must be positive.\n",
+            argv[0]);
+        return 1;
+    }
+
+    const Transition transitions[] = {
+        { "linregr_transition", LinearRegression::transition,
+            LinearRegression::transitionInPlace, 5, false },
+        { "logregr_cg_step_transition", LogisticRegressionCG::transition,
+            LogisticRegressionCG::transitionInPlace, 6, true },
+        { "logregr_irls_step_transition", LogisticRegressionIRLS::transition,
+            LogisticRegressionIRLS::transitionInPlace, 4, true }
+    };
+
+    for (unsigned int i = 0; i < widths.size(); i++) {
+        DesignMatrix data(widths[i], 1000);
+
+        for (unsigned int j = 0;
+            j < sizeof(transitions) / sizeof(transitions[0]); j++) {
+
+            Array<double> generic
+                = runTransition(transitions[j], data, numRows, false);
+            Array<double> inPlace
+                = runTransition(transitions[j], data, numRows, true);
+            std::printf("%-40s width %4u: max. state difference %g\n",
+                transitions[j].name, static_cast<unsigned int>(widths[i]),
+                maxDifference(generic, inPlace));
+        }
+    }
+
+    // For the distribution functions, we report the maximum degree of freedom
+    // instead of the width.
+    DesignMatrix data(2, 1000);
+    const uint16_t maxNus[] = { 10, 100 };
+    for (unsigned int i = 0; i < sizeof(maxNus) / sizeof(maxNus[0]); i++) {
+        double sum = runCDF("student_t_cdf", student_t_cdf, data, numRows,
+            maxNus[i]);
+        sum += runCDF("chi_squared_cdf", chi_squared_cdf, data, numRows,
+            maxNus[i]);
+        sum += runArrayCDF("student_t_cdf_array", student_t_cdf_array, data,
+            numRows, maxNus[i]);
+        sum += runArrayCDF("chi_squared_cdf_array", chi_squared_cdf_array,
+            data, numRows, maxNus[i]);
+        std::printf("%-40s   nu %4u: checksum %g\n", "cdf",
+            static_cast<unsigned int>(maxNus[i]), sum);
+    }
+
+    // Compare the methods for the Student-t distribution function. The
+    // series uses approximations for nu >= 200.
+    const int64_t nus[] = { 5, 50, 199, 1000 };
+    for (unsigned int i = 0; i < sizeof(nus) / sizeof(nus[0]); i++) {
+        std::vector<double> series, ibeta;
+        runStudentTKernel("studentT_cdf_series", studentT_cdf_series, data,
+            numRows, nus[i], series);
+        runStudentTKernel("studentT_cdf_ibeta", studentT_cdf_ibeta, data,
+            numRows, nus[i], ibeta);
+
+        double diff = 0;
+        for (unsigned int j = 0; j < series.size(); j++)
+            diff = std::max(diff, std::fabs(series[j] - ibeta[j]));
+        std::printf("%-40s   nu %4u: max. difference %g\n", "studentT_cdf",
+            static_cast<unsigned int>(nus[i]), diff);
+    }
+
+    return 0;
+}
@@ -9,7 +9,10 @@
  * @brief Abstract base class for an output stream buffer
  *
  * We start out with a 1K buffer that can grow up to 16K. After that, all input
- * is ignored until the next pubsync() call. A convenient way to implicitly call
+ * is ignored until the next pubsync() call. The buffer is only allocated when
+ * the first character is written, so that a stream that is never used (e.g.,
+ * the output streams of an aggregate transition function that does not log)
+ * costs no heap allocation. A convenient way to implicitly call
  * pubsync() is with the endl manipulator.
  *
  * Use this class by passing the pointer of an instance to the
@@ -25,17 +28,18 @@ public:
     static const uint32_t kMaxBufferSize = 16384;
 
     /**
-     * @internal One extra byte is allocated for the terminating null character.
+     * @internal The put area is initially empty, so the first character
+     *     written triggers overflow(), which allocates the buffer.
      */
     AbstractOutputStreamBuffer()
-    :   mStorageSize(kInitialBufferSize),
-        mStorage(new _CharT[kInitialBufferSize + 1]) {
-        
-        setp(mStorage, mStorage + mStorageSize);
+    :   mStorageSize(0),
+        mStorage(NULL) {
+
+        this->setp(NULL, NULL);
     }
 
     virtual ~AbstractOutputStreamBuffer() {
-        delete mStorage;
+        delete[] mStorage;
     }
     
     /**
@@ -53,11 +57,23 @@ protected:
      * @brief Handle case when stream receives a character that does not fit
      *        into the current buffer any more
      *
-     * This function will allocate a new buffer of twice the old buffer size. If
-     * the buffer has already the maximum size kMaxBufferSize, eof is returned
-     * to indicate that the buffer cannot take any more input before a flush.
+     * This function will allocate a new buffer of twice the old buffer size
+     * (or the initial buffer if none has been allocated yet). If the buffer has
+     * already the maximum size kMaxBufferSize, eof is returned to indicate that
+     * the buffer cannot take any more input before a flush.
+     *
+     * @internal One extra byte is allocated for the terminating null character.
      */
     virtual int_type overflow(int_type c = traits_type::eof()) {
+        if (mStorage == NULL) {
+            if (c == traits_type::eof())
+                return traits_type::eof();
+
+            mStorage = new _CharT[kInitialBufferSize + 1];
+            mStorageSize = kInitialBufferSize;
+            this->setp(mStorage, mStorage + mStorageSize);
+        }
+
         if (this->pptr() >= this->epptr()) {
             if (mStorageSize >= kMaxBufferSize)
                 return traits_type::eof();
@@ -65,7 +81,7 @@ protected:
             uint32_t newStorageSize = mStorageSize * 2;
             _CharT *newStorage = new _CharT[newStorageSize + 1];
             std::memcpy(newStorage, mStorage, mStorageSize);
-            delete mStorage;
+            delete[] mStorage;
             mStorage = newStorage;
             
             BOOST_ASSERT_MSG(
@@ -73,7 +89,7 @@ protected:
                 this->pptr() - this->pbase() == static_cast<int64_t>(mStorageSize),
                 "Internal error: Logging buffer has become inconsistent");
             
-            setp(mStorage, mStorage + newStorageSize);
+            this->setp(mStorage, mStorage + newStorageSize);
             this->pbump(mStorageSize);
             mStorageSize = newStorageSize;
         } else if (c == traits_type::eof())
@@ -86,14 +102,19 @@ protected:
 
     /**
      * @brief Flush and reset buffer.
+     *
+     * Nothing is output if nothing has ever been written to the stream.
      */
     virtual int sync() {
+        if (mStorage == NULL)
+            return 0;
+
         int length = this->pptr() - this->pbase();
         
         mStorage[length] = '\0';
         output(mStorage, length);
 
-        setp(mStorage, mStorage + mStorageSize);
+        this->setp(mStorage, mStorage + mStorageSize);
         return 0;
     }
         
@@ -0,0 +1,259 @@
+/* ----------------------------------------------------------------------- *//**
+ *
+ * @file Args.hpp
+ *
+ * @brief Allocation-free, statically typed access to function arguments
+ *
+ *//* ----------------------------------------------------------------------- */
+
+/**
+ * @brief Plain-old-data description of a single function argument
+ *
+ * Connectors fill an array of RawArgument structs (typically on the stack)
+ * without calling into the heap. Unlike AnyValue, no virtual dispatch and no
+ * reference counting is involved.
+ */
+struct RawArgument {
+    enum Type {
+        kNull = 0,
+        kBool,
+        kInt16,
+        kInt32,
+        kInt64,
+        kFloat,
+        kDouble,
+        kDoubleArray
+    };
+
+    Type type;
+
+    /**
+     * @brief Whether the memory may be modified in-place (only the case for
+     *        the transition state of aggregate functions)
+     */
+    bool isMutable;
+
+    union {
+        bool boolValue;
+        int16_t int16Value;
+        int32_t int32Value;
+        int64_t int64Value;
+        float floatValue;
+        double doubleValue;
+    } value;
+
+    /**
+     * @brief Raw data of an array (only valid if type == kDoubleArray)
+     */
+    double *data;
+    uint32_t numElements;
+
+    /**
+     * @brief Connector-specific pointer to the DBMS-native object (e.g., the
+     *        detoasted array). Opaque to everybody else.
+     */
+    void *native;
+};
+
+/**
+ * @brief Conversion of a RawArgument into a typed value
+ *
+ * Each specialization provides
+ * - <tt>static bool accepts(const RawArgument &)</tt>, which checks without
+ *   side effects whether the conversion is possible, and
+ * - <tt>static T get(const RawArgument &)</tt>, which performs the
+ *   conversion. It is only valid to call get() if accepts() returned true.
+ *
+ * As with ConcreteValue, we only allow lossless conversions. Conversions into
+ * mutable types require that the argument is mutable.
+ */
+template <typename T>
+struct ArgumentTraits;
+
+template <>
+struct ArgumentTraits<Null> {
+    static bool accepts(const RawArgument &) { return true; }
+    static Null get(const RawArgument &) { return Null(); }
+};
+
+template <>
+struct ArgumentTraits<bool> {
+    static bool accepts(const RawArgument &inArg) {
+        return inArg.type == RawArgument::kBool;
+    }
+
+    static bool get(const RawArgument &inArg) {
+        return inArg.value.boolValue;
+    }
+};
+
+template <>
+struct ArgumentTraits<int32_t> {
+    static bool accepts(const RawArgument &inArg) {
+        return inArg.type == RawArgument::kInt16
+            || inArg.type == RawArgument::kInt32;
+    }
+
+    static int32_t get(const RawArgument &inArg) {
+        return inArg.type == RawArgument::kInt16
+            ? inArg.value.int16Value
+            : inArg.value.int32Value;
+    }
+};
+
+template <>
+struct ArgumentTraits<int64_t> {
+    static bool accepts(const RawArgument &inArg) {
+        return inArg.type == RawArgument::kInt16
+            || inArg.type == RawArgument::kInt32
+            || inArg.type == RawArgument::kInt64;
+    }
+
+    static int64_t get(const RawArgument &inArg) {
+        switch (inArg.type) {
+            case RawArgument::kInt16: return inArg.value.int16Value;
+            case RawArgument::kInt32: return inArg.value.int32Value;
+            default: return inArg.value.int64Value;
+        }
+    }
+};
+
+template <>
+struct ArgumentTraits<double> {
+    static bool accepts(const RawArgument &inArg) {
+        return inArg.type == RawArgument::kInt16
+            || inArg.type == RawArgument::kInt32
+            || inArg.type == RawArgument::kFloat
+            || inArg.type == RawArgument::kDouble;
+    }
+
+    static double get(const RawArgument &inArg) {
+        switch (inArg.type) {
+            case RawArgument::kInt16: return inArg.value.int16Value;
+            case RawArgument::kInt32: return inArg.value.int32Value;
+            case RawArgument::kFloat: return inArg.value.floatValue;
+            default: return inArg.value.doubleValue;
+        }
+    }
+};
+
+template <>
+struct ArgumentTraits< Array<double> > {
+    static bool accepts(const RawArgument &inArg) {
+        return inArg.type == RawArgument::kDoubleArray && inArg.isMutable;
+    }
+
+    static Array<double> get(const RawArgument &inArg) {
+        return Array<double>(inArg.data, boost::extents[ inArg.numElements ]);
+    }
+};
+
+template <>
+struct ArgumentTraits< Array_const<double> > {
+    static bool accepts(const RawArgument &inArg) {
+        return inArg.type == RawArgument::kDoubleArray;
+    }
+
+    static Array_const<double> get(const RawArgument &inArg) {
+        return Array_const<double>(inArg.data,
+            boost::extents[ inArg.numElements ]);
+    }
+};
+
+template <template <class> class T>
+struct ArgumentTraits< Vector<T, double> > {
+    static bool accepts(const RawArgument &inArg) {
+        return inArg.type == RawArgument::kDoubleArray && inArg.isMutable;
+    }
+
+    static Vector<T, double> get(const RawArgument &inArg) {
+        return Vector<T, double>(inArg.data, inArg.numElements);
+    }
+};
+
+template <template <class> class T>
+struct ArgumentTraits< Vector_const<T, double> > {
+    static bool accepts(const RawArgument &inArg) {
+        return inArg.type == RawArgument::kDoubleArray;
+    }
+
+    static Vector_const<T, double> get(const RawArgument &inArg) {
+        return Vector_const<T, double>(inArg.data, inArg.numElements);
+    }
+};
+
+/**
+ * @brief Statically typed argument list
+ *
+ * Args is the allocation-free alternative to iterating over an AnyValue. It is
+ * meant for functions that are called once per row, most notably transition
+ * functions of aggregates. Example:
+ * @code
+ * typedef Args<Array<double>, double, DoubleRow_const> TransitionArgs;
+ *
+ * if (!TransitionArgs::accepts(inArgs, inNumArgs))
+ *     return false; // Let the generic code path deal with it
+ * TransitionArgs args(inArgs, inNumArgs);
+ * double y = args.get<1>();
+ * @endcode
+ * All views (arrays, vectors) are bound to the memory described by the
+ * RawArgument structs. No memory handles are created.
+ *
+ * Unused trailing type parameters are Null. Arguments beyond the last
+ * non-Null type parameter are ignored.
+ */
+template <typename T0, typename T1 = Null, typename T2 = Null,
+    typename T3 = Null>
+class Args : public boost::tuple<T0, T1, T2, T3> {
+    typedef boost::tuple<T0, T1, T2, T3> Base;
+
+public:
+    /**
+     * @brief Number of leading arguments this argument list reads
+     *
+     * Connectors need not unpack any arguments beyond these.
+     */
+    static const uint16_t kNumArgs =
+        !boost::is_same<T3, Null>::value ? 4
+        : !boost::is_same<T2, Null>::value ? 3
+        : !boost::is_same<T1, Null>::value ? 2
+        : 1;
+
+    Args(const RawArgument *inArgs, uint16_t inNumArgs)
+        : Base(
+            convert<T0>(inArgs, inNumArgs, 0),
+            convert<T1>(inArgs, inNumArgs, 1),
+            convert<T2>(inArgs, inNumArgs, 2),
+            convert<T3>(inArgs, inNumArgs, 3))
+        { }
+
+    /**
+     * @brief Check whether the arguments can be converted to the types of this
+     *        argument list
+     */
+    static bool accepts(const RawArgument *inArgs, uint16_t inNumArgs) {
+        return ArgumentTraits<T0>::accepts(at(inArgs, inNumArgs, 0))
+            && ArgumentTraits<T1>::accepts(at(inArgs, inNumArgs, 1))
+            && ArgumentTraits<T2>::accepts(at(inArgs, inNumArgs, 2))
+            && ArgumentTraits<T3>::accepts(at(inArgs, inNumArgs, 3));
+    }
+
+private:
+    static const RawArgument &at(const RawArgument *inArgs, uint16_t inNumArgs,
+        uint16_t inID) {
+
+        static const RawArgument sNull = { RawArgument::kNull };
+        return inID < inNumArgs ? inArgs[inID] : sNull;
+    }
+
+    template <typename T>
+    static T convert(const RawArgument *inArgs, uint16_t inNumArgs,
+        uint16_t inID) {
+
+        if (!ArgumentTraits<T>::accepts(at(inArgs, inNumArgs, inID)))
+            throw std::invalid_argument(
+                "Internal argument type does not match SQL argument type");
+
+        return ArgumentTraits<T>::get(at(inArgs, inNumArgs, inID));
+    }
+};
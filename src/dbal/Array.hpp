@@ -40,6 +40,20 @@ public:
           mMemoryHandle(inHandle)
         { }
     
+    /**
+     * @brief Bind the array to a plain pointer, without a memory handle
+     *
+     * The caller is responsible for keeping the memory alive as long as the
+     * array is in use. This constructor never allocates.
+     */
+    inline Array(
+        T *inPtr,
+        const extent_gen &ranges)
+        : multi_array_ref<T, NumDims>(
+            inPtr,
+            ranges)
+        { }
+    
     inline Array(
         AllocatorSPtr inAllocator,
         const extent_gen &ranges)
@@ -103,7 +117,22 @@ public:
         const extent_gen &ranges) {
         
         mMemoryHandle = inHandle;
-        return internalRebind(ranges);
+        return internalRebind(static_cast<T*>(mMemoryHandle->ptr()), ranges);
+    }
+    
+    /**
+     * @brief Rebind the array to a plain pointer, without a memory handle
+     *
+     * @param inPtr the new base pointer
+     * @param ranges the extent for each dimensions, of form
+     *     <tt>boost::extents[ dim1 ][ dim2 ][ ... ]</tt>
+     */
+    inline Array &rebind(
+        T *inPtr,
+        const extent_gen &ranges) {
+        
+        mMemoryHandle.reset();
+        return internalRebind(inPtr, ranges);
     }
     
     /**
@@ -120,7 +149,7 @@ public:
         
         mMemoryHandle = inAllocator->allocateArray(getNumElements(ranges),
             static_cast<T*>(NULL) /* pure type parameter */);
-        return internalRebind(ranges);
+        return internalRebind(static_cast<T*>(mMemoryHandle->ptr()), ranges);
     }
     
     inline MemHandleSPtr memoryHandle() const {
@@ -144,8 +173,8 @@ protected:
             size_type(1), std::multiplies<size_type>());
     }
     
-    inline Array &internalRebind(const extent_gen &ranges) {
-        this->set_base_ptr(static_cast<T*>(mMemoryHandle->ptr()));
+    inline Array &internalRebind(T *inPtr, const extent_gen &ranges) {
+        this->set_base_ptr(inPtr);
 
         // See init_from_extent_gen()
         // get the index_base values
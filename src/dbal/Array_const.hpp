@@ -48,6 +48,20 @@ public:
           mMemoryHandle(inHandle)
         { }
     
+    /**
+     * @brief Bind the array to a plain pointer, without a memory handle
+     *
+     * The caller is responsible for keeping the memory alive as long as the
+     * array is in use. This constructor never allocates.
+     */
+    inline Array_const(
+        const T *inPtr,
+        const extent_gen &ranges)
+        : const_multi_array_ref<T, NumDims>(
+            inPtr,
+            ranges)
+        { }
+    
     inline Array_const(
         AllocatorSPtr inAllocator,
         const extent_gen &ranges)
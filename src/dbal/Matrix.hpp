@@ -55,6 +55,39 @@ public:
           mMemoryHandle(inHandle)
         { }
     
+    /**
+     * @brief Construct an empty matrix that still needs to be bound to memory
+     *
+     * @internal We need to use auxiliary memory already here, so that
+     *     Armadillo will not attempt to free the memory we rebind to later.
+     */
+    inline Matrix()
+        : arma::Mat<eT>(
+            static_cast<eT*>(NULL),
+            0,
+            0,
+            false /* copy_aux_mem */,
+            true /* strict */)
+        { }
+
+    /**
+     * @brief Bind the matrix to a plain pointer, without a memory handle
+     *
+     * The caller is responsible for keeping the memory alive as long as the
+     * matrix is in use. This constructor never allocates.
+     */
+    inline Matrix(
+        eT *inPtr,
+        const uint32_t inNumRows,
+        const uint32_t inNumCols)
+        : arma::Mat<eT>(
+            inPtr,
+            inNumRows,
+            inNumCols,
+            false /* copy_aux_mem */,
+            true /* strict */)
+        { }
+
     inline Matrix(
         const Matrix<eT> &inMat)
         : arma::Mat<eT>(
@@ -87,14 +120,31 @@ public:
         const uint32_t inNumRows,
         const uint32_t inNumCols) {
         
+        rebind(static_cast<eT*>(inHandle->ptr()), inNumRows, inNumCols);
+        mMemoryHandle = inHandle;
+        return *this;
+    }
+
+    /**
+     * @brief Rebind the matrix to a plain pointer, without a memory handle
+     *
+     * @param inPtr the new memory
+     * @param inNumRows number of rows after the reallocation
+     * @param inNumCols number of columns after the reallocation
+     */
+    inline Matrix &rebind(
+        eT *inPtr,
+        const uint32_t inNumRows,
+        const uint32_t inNumCols) {
+        
         using arma::access;
         using arma::Mat;
         
         access::rw(Mat<eT>::n_rows) = inNumRows;
         access::rw(Mat<eT>::n_cols) = inNumCols;
         access::rw(Mat<eT>::n_elem) = inNumRows * inNumCols;
-        access::rw(Mat<eT>::mem) = static_cast<eT*>(inHandle->ptr());
-        mMemoryHandle = inHandle;
+        access::rw(Mat<eT>::mem) = inPtr;
+        mMemoryHandle.reset();
         return *this;
     }
 
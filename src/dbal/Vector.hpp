@@ -22,6 +22,36 @@
 template<template <class> class T, typename eT>
 class Vector : public T<eT> {
 public:
+    /**
+     * @brief Construct an empty vector that still needs to be bound to memory
+     *
+     * @internal We need to use auxiliary memory already here, so that
+     *     Armadillo will not attempt to free the memory we rebind to later.
+     */
+    inline Vector()
+        : T<eT>(
+            static_cast<eT*>(NULL),
+            0,
+            false /* copy_aux_mem */,
+            true /* strict */)
+        { }
+
+    /**
+     * @brief Bind the vector to a plain pointer, without a memory handle
+     *
+     * The caller is responsible for keeping the memory alive as long as the
+     * vector is in use. This constructor never allocates.
+     */
+    inline Vector(
+        eT *inPtr,
+        const uint32_t inNumElem)
+        : T<eT>(
+            inPtr,
+            inNumElem,
+            false /* copy_aux_mem */,
+            true /* strict */)
+        { }
+
     inline Vector(
         AllocatorSPtr inAllocator,
         const uint32_t inNumElem)
@@ -79,6 +109,15 @@ public:
     }
     
     inline Vector &rebind(const MemHandleSPtr inHandle, const uint32_t inNumElem) {
+        rebind(static_cast<eT*>(inHandle->ptr()), inNumElem);
+        mMemoryHandle = inHandle;
+        return *this;
+    }
+
+    /**
+     * @brief Rebind the vector to a plain pointer, without a memory handle
+     */
+    inline Vector &rebind(eT *inPtr, const uint32_t inNumElem) {
         using arma::access;
         using arma::Mat;
     
@@ -92,8 +131,8 @@ public:
             access::rw(Mat<eT>::n_cols) = inNumElem;
         
         access::rw(Mat<eT>::n_elem) = inNumElem;
-        access::rw(Mat<eT>::mem) = static_cast<eT*>(inHandle->ptr());
-        mMemoryHandle = inHandle;
+        access::rw(Mat<eT>::mem) = inPtr;
+        mMemoryHandle.reset();
         return *this;
     }
 
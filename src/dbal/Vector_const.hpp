@@ -53,6 +53,43 @@ public:
           n_elem(mVector.n_elem)
         { }
 
+    /**
+     * @brief Bind the vector to a plain pointer, without a memory handle
+     *
+     * The caller is responsible for keeping the memory alive as long as the
+     * vector is in use. This constructor never allocates.
+     */
+    inline Vector_const(
+        const eT *inPtr,
+        const uint32_t inNumElem)
+        : mVector(
+            const_cast<eT*>(inPtr),
+            inNumElem,
+            false /* copy_aux_mem */,
+            true /* strict */),
+          n_rows(mVector.n_rows),
+          n_cols(mVector.n_cols),
+          n_elem(mVector.n_elem)
+        { }
+
+    /**
+     * @internal It is important to define this constructor. Otherwise, C++
+     *     would copy mVector (which performs a deep copy) and bind n_rows,
+     *     n_cols, and n_elem to the members of the original object.
+     */
+    inline Vector_const(
+        const Vector_const<T, eT> &inVec)
+        : mMemoryHandle(inVec.mMemoryHandle),
+          mVector(
+            const_cast<eT*>(inVec.mVector.memptr()),
+            inVec.n_elem,
+            false /* copy_aux_mem */,
+            true /* strict */),
+          n_rows(mVector.n_rows),
+          n_cols(mVector.n_cols),
+          n_elem(mVector.n_elem)
+        { }
+
     inline Vector_const(
         const Vector<T, eT> &inVec)
         : mMemoryHandle(inVec.mMemoryHandle),
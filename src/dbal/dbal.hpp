@@ -20,6 +20,10 @@
 // Array
 #include <boost/multi_array.hpp>
 
+// Args
+#include <boost/tuple/tuple.hpp>
+#include <boost/type_traits/is_same.hpp>
+
 // Matrix, Vector
 #include <armadillo>
 
@@ -148,6 +152,7 @@ namespace dbal {
 // Simple Helper Classes
 
 #include <dbal/TransparentHandle.hpp>
+#include <dbal/Args.hpp>
 
 // Implementation Classes (Headers)
 
@@ -14,37 +14,86 @@
  * provides functionality to getting the argument list (and the respective
  * argument and return types). 
  *
- * Each compliant platform port must provide the following two macros:
+ * Each compliant platform port must provide the following three macros:
  * @code
  * DECLARE_UDF_EXT(SQLName, NameSpace, Function)
  * DECLARE_UDF(NameSpace, Function)
+ * DECLARE_UDF_INPLACE_EXT(SQLName, NameSpace, Function, InPlaceFunction,
+ *     InPlaceArgs)
  * @endcode
  * where \c SQLName is the external name (which the database will use as entry
  * point when calling the madlib library) and \c Function is the internal class
- * name implementing the UDF.
+ * name implementing the UDF. \c InPlaceFunction is an allocation-free variant
+ * of \c Function that receives its arguments as RawArgument structs and
+ * returns whether it could handle the call by modifying the first argument
+ * in-place. \c InPlaceArgs is the Args type that \c InPlaceFunction binds
+ * to; ports only need to unpack its first <tt>InPlaceArgs::kNumArgs</tt>
+ * arguments. A port may ignore \c InPlaceFunction and always call
+ * \c Function.
  */
 
 // prob/chiSquared.hpp
 DECLARE_UDF(prob, chi_squared_cdf)
+DECLARE_UDF(prob, chi_squared_cdf_array)
 
 // prob/student.hpp
 DECLARE_UDF(prob, student_t_cdf)
+DECLARE_UDF(prob, student_t_cdf_array)
 
 
 // regress/linear.hpp
-DECLARE_UDF_EXT(linregr_transition, regress, LinearRegression::transition)
+DECLARE_UDF_INPLACE_EXT(linregr_transition, regress, LinearRegression::transition,
+    LinearRegression::transitionInPlace, LinearRegression::TransitionArgs)
 DECLARE_UDF_EXT(linregr_merge_states, regress, LinearRegression::mergeStates)
 DECLARE_UDF_EXT(linregr_final, regress, LinearRegression::final)
+DECLARE_UDF_EXT(linregr_compact_state, regress, LinearRegression::compactState)
+DECLARE_UDF_EXT(linregr_state_update, regress, LinearRegression::updateState)
+DECLARE_UDF_EXT(linregr_from_state, regress, LinearRegression::final)
+DECLARE_UDF_INPLACE_EXT(linregr_grouped_transition, regress,
+    GroupedLinearRegression::transition,
+    GroupedLinearRegression::transitionInPlace,
+    GroupedLinearRegression::TransitionArgs)
+DECLARE_UDF_EXT(linregr_grouped_merge_states, regress,
+    GroupedLinearRegression::mergeStates)
+DECLARE_UDF_EXT(linregr_grouped_final, regress, GroupedLinearRegression::final)
     
 // regress/logistic.hpp
-DECLARE_UDF_EXT(logregr_cg_step_transition, regress, LogisticRegressionCG::transition)
+DECLARE_UDF_INPLACE_EXT(logregr_cg_step_transition, regress, LogisticRegressionCG::transition,
+    LogisticRegressionCG::transitionInPlace,
+    LogisticRegressionCG::TransitionArgs)
+DECLARE_UDF_EXT(logregr_cg_step_block_transition, regress,
+    LogisticRegressionCG::blockTransition)
 DECLARE_UDF_EXT(logregr_cg_step_merge_states, regress, LogisticRegressionCG::mergeStates)
 DECLARE_UDF_EXT(logregr_cg_step_final, regress, LogisticRegressionCG::final)
+DECLARE_UDF_EXT(internal_logregr_cg_initial_state, regress,
+    LogisticRegressionCG::initialState)
 DECLARE_UDF_EXT(internal_logregr_cg_step_distance, regress, LogisticRegressionCG::distance)
 DECLARE_UDF_EXT(internal_logregr_cg_result, regress, LogisticRegressionCG::result)
 
-DECLARE_UDF_EXT(logregr_irls_step_transition, regress, LogisticRegressionIRLS::transition)
+DECLARE_UDF_INPLACE_EXT(logregr_irls_step_transition, regress, LogisticRegressionIRLS::transition,
+    LogisticRegressionIRLS::transitionInPlace,
+    LogisticRegressionIRLS::TransitionArgs)
+DECLARE_UDF_EXT(logregr_irls_step_block_transition, regress,
+    LogisticRegressionIRLS::blockTransition)
 DECLARE_UDF_EXT(logregr_irls_step_merge_states, regress, LogisticRegressionIRLS::mergeStates)
 DECLARE_UDF_EXT(logregr_irls_step_final, regress, LogisticRegressionIRLS::final)
+DECLARE_UDF_EXT(internal_logregr_irls_initial_state, regress,
+    LogisticRegressionIRLS::initialState)
 DECLARE_UDF_EXT(internal_logregr_irls_step_distance, regress, LogisticRegressionIRLS::distance)
 DECLARE_UDF_EXT(internal_logregr_irls_result, regress, LogisticRegressionIRLS::result)
+
+DECLARE_UDF_INPLACE_EXT(logregr_igd_step_transition, regress, LogisticRegressionIGD::transition,
+    LogisticRegressionIGD::transitionInPlace,
+    LogisticRegressionIGD::TransitionArgs)
+DECLARE_UDF_EXT(logregr_igd_step_merge_states, regress, LogisticRegressionIGD::mergeStates)
+DECLARE_UDF_EXT(logregr_igd_step_final, regress, LogisticRegressionIGD::final)
+DECLARE_UDF_EXT(internal_logregr_igd_initial_state, regress,
+    LogisticRegressionIGD::initialState)
+DECLARE_UDF_EXT(internal_logregr_igd_step_distance, regress, LogisticRegressionIGD::distance)
+DECLARE_UDF_EXT(internal_logregr_igd_result, regress, LogisticRegressionIGD::result)
+
+// regress/design_matrix.hpp
+DECLARE_UDF_EXT(internal_design_matrix_block_transition, regress,
+    DesignMatrixBlock::transition)
+DECLARE_UDF_EXT(internal_design_matrix_block_final, regress,
+    DesignMatrixBlock::final)
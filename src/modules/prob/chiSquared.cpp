@@ -35,6 +35,32 @@ AnyValue chi_squared_cdf(AbstractDBInterface &db, AnyValue args) {
     return boost::math::cdf( boost::math::chi_squared(nu), t );
 }
 
+/**
+ * @brief Chi-squared cumulative distribution function for an array of
+ *        arguments: In-database interface
+ *
+ * The distribution object (and thus its parameter checks) is set up only once
+ * for all arguments.
+ */
+AnyValue chi_squared_cdf_array(AbstractDBInterface &db, AnyValue args) {
+    AnyValue::iterator arg(args);
+
+    // Arguments from SQL call
+    const int64_t nu = *arg++;
+    Array_const<double> t = *arg;
+
+    /* We want to ensure nu > 0 */
+    if (nu <= 0)
+        throw std::domain_error("Chi Squared distribution undefined for "
+            "degree of freedom <= 0");
+
+    boost::math::chi_squared distribution(nu);
+    Array<double> cdf(db.allocator(), boost::extents[ t.size() ]);
+    for (std::size_t i = 0; i < t.size(); i++)
+        cdf[i] = boost::math::cdf(distribution, t[i]);
+    return cdf;
+}
+
 
 } // namespace prob
 
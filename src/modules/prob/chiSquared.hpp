@@ -19,6 +19,8 @@ namespace prob {
 
 AnyValue chi_squared_cdf(AbstractDBInterface &db, AnyValue args);
 
+AnyValue chi_squared_cdf_array(AbstractDBInterface &db, AnyValue args);
+
 } // namespace prob
 
 } // namespace modules
@@ -19,8 +19,19 @@ namespace prob {
 
 double studentT_cdf(int64_t nu, double t);
 
+void studentT_cdf(int64_t nu, const double *inT, double *outCDF,
+    uint32_t inNumValues);
+
+void studentT_cdf_series(int64_t nu, const double *inT, double *outCDF,
+    uint32_t inNumValues);
+
+void studentT_cdf_ibeta(int64_t nu, const double *inT, double *outCDF,
+    uint32_t inNumValues);
+
 AnyValue student_t_cdf(AbstractDBInterface &db, AnyValue args);
 
+AnyValue student_t_cdf_array(AbstractDBInterface &db, AnyValue args);
+
 } // namespace prob
 
 } // namespace modules
@@ -0,0 +1,82 @@
+/* ----------------------------------------------------------------------- *//**
+ *
+ * @file design_matrix.cpp
+ *
+ * @brief Blocks of rows of a design matrix
+ *
+ *//* ----------------------------------------------------------------------- */
+
+#include <modules/regress/design_matrix.hpp>
+
+#include <algorithm>
+
+namespace madlib {
+
+namespace modules {
+
+namespace regress {
+
+/**
+ * @brief Append a row to a block
+ *
+ * The arguments are the block, the dependent variable, and the vector of
+ * independent variables. The array grows
+ * geometrically, so that each row is copied only a constant number of times on
+ * average.
+ */
+AnyValue DesignMatrixBlock::transition(AbstractDBInterface &db, AnyValue args) {
+    AnyValue::iterator arg(args);
+    
+    Array<double> block = arg->copyIfImmutable();
+    ++arg;
+    double y = *arg++;
+    DoubleRow_const x = *arg++;
+    
+    uint32_t numRows = static_cast<uint32_t>(block[0]);
+    uint16_t widthOfX = static_cast<uint16_t>(block[1]);
+    if (numRows == 0)
+        widthOfX = x.n_elem;
+    else if (x.n_elem != widthOfX)
+        throw std::invalid_argument("Inconsistent numbers of independent "
+            "variables.");
+    
+    std::size_t recordSize = 1 + static_cast<std::size_t>(widthOfX);
+    std::size_t used = kHeaderSize + numRows * recordSize;
+    if (block.size() < used + recordSize) {
+        // Array copies are shallow, so this only keeps the old block alive
+        Array<double> oldBlock(block);
+        block.rebind(db.allocator(AbstractAllocator::kAggregate),
+            boost::extents[ std::max(used + recordSize, 2 * oldBlock.size()) ]);
+        std::copy(oldBlock.data(), oldBlock.data() + used, block.data());
+    }
+    
+    const double *xData = static_cast<const arma::rowvec&>(x).memptr();
+    double *record = block.data() + used;
+    record[0] = y;
+    std::copy(xData, xData + widthOfX, record + 1);
+    block[0] = numRows + 1;
+    block[1] = widthOfX;
+    return block;
+}
+
+/**
+ * @brief Return the block without the unused space at the end
+ */
+AnyValue DesignMatrixBlock::final(AbstractDBInterface &db, AnyValue args) {
+    Array_const<double> block = args[0];
+    
+    std::size_t used = kHeaderSize
+        + static_cast<std::size_t>(block[0]) * (1 + block[1]);
+    if (block.size() == used)
+        return args[0];
+    
+    Array<double> result(db.allocator(), boost::extents[ used ]);
+    std::copy(block.data(), block.data() + used, result.data());
+    return result;
+}
+
+} // namespace regress
+
+} // namespace modules
+
+} // namespace madlib
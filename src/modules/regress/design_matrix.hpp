@@ -0,0 +1,46 @@
+/* ----------------------------------------------------------------------- *//**
+ *
+ * @file design_matrix.hpp
+ *
+ *//* ----------------------------------------------------------------------- */
+
+#ifndef MADLIB_REGRESS_DESIGN_MATRIX_H
+#define MADLIB_REGRESS_DESIGN_MATRIX_H
+
+#include <modules/common.hpp>
+
+namespace madlib {
+
+namespace modules {
+
+namespace regress {
+
+/**
+ * @brief Blocks of rows of a design matrix, for caching it between iterations
+ *
+ * Iterative algorithms scan the same rows many times. Packing many rows into
+ * one DOUBLE PRECISION array means that the database needs to decode only one
+ * array per block, instead of one array per row.
+ *
+ * @internal Array layout:
+ * - 0: numRows (number of rows in the block)
+ * - 1: widthOfX (number of independent variables)
+ * - 2: rows (numRows records of 1 + widthOfX elements each: the dependent
+ *   variable, followed by the independent variables)
+ *
+ * While the block is being built, the array may be longer than needed.
+ */
+struct DesignMatrixBlock {
+    enum { kHeaderSize = 2 };
+    
+    static AnyValue transition(AbstractDBInterface &db, AnyValue args);
+    static AnyValue final(AbstractDBInterface &db, AnyValue args);
+};
+
+} // namespace regress
+
+} // namespace modules
+
+} // namespace regress
+
+#endif
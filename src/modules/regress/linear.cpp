@@ -9,11 +9,19 @@
 #include <modules/regress/linear.hpp>
 #include <modules/prob/student.hpp>
 #include <utils/Reference.hpp>
+#include <utils/packedSymmetric.hpp>
+#include <utils/GramBuffer.hpp>
+#include <utils/SymmetricPositiveDecomposition.hpp>
 
 // Floating-point classification functions are in C99 and TR1, but not in the
 // official C++ Standard (before C++0x). We therefore use the Boost implementation
 #include <boost/math/special_functions/fpclassify.hpp>
 
+#include <algorithm>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
 
 // Import names from Armadillo
 using arma::vec;
@@ -23,6 +31,12 @@ using arma::as_scalar;
 namespace madlib {
 
 using utils::Reference;
+using utils::GramBuffer;
+using utils::packedSize;
+using utils::symmetricRankOneUpdate;
+using utils::unpackSymmetric;
+using utils::packUpperTriangle;
+using utils::SymmetricPositiveDecomposition;
 
 namespace modules {
 
@@ -41,27 +55,168 @@ namespace regress {
  *
  * Note: We assume that the DOUBLE PRECISION array is initialized by the
  * database with length at least 5, and all elemenets are 0.
+ *
+ * Since \f$ X^T X \f$ is symmetric, only its upper triangle is stored, in
+ * packed form (see packedSymmetric.hpp). This halves the size of the state,
+ * which matters when states are shipped between segments for merging.
+ *
+ * For wide designs, rows are not added to \f$ X^T X \f$ one at a time.
+ * Instead, they are collected in a GramBuffer at the end of the state and
+ * added block-wise. Buffered rows are taken into account by the merge and
+ * final functions.
+ *
+ * @internal Array layout (version 2):
+ * - 0: layout (always kLayout)
+ * - 1: numRows (number of rows processed so far)
+ * - 2: widthOfX (number of independent variables)
+ * - 3: y_sum (sum of dependent variables)
+ * - 4: y_square_sum (sum of squares of dependent variables)
+ * - 5: X_transp_Y (X^T y)
+ * - 5 + widthOfX: X_transp_X (X^T X, packed upper triangle)
+ * - 5 + widthOfX + widthOfX * (widthOfX + 1) / 2: bufferedRows (rows not yet
+ *   added to X_transp_X, see GramBuffer)
+ *
+ * In compact form (see compact()), bufferedRows is omitted. This is the form
+ * in which states are persisted. It is also the form of states embedded in
+ * other states (see GroupedLinearRegression), which add rows directly to
+ * X_transp_X. The legacy layout (version 1) was: numRows,
+ * widthOfX, y_sum, y_square_sum, X_transp_Y, X_transp_X (dense). upgrade()
+ * converts both into the current layout.
  */
 class LinearRegression::TransitionState {
 public:
+    TransitionState(AnyValue inArg)
+        : mStorage(inArg.copyIfImmutable()) {
+        
+        rebind(static_cast<uint16_t>(mStorage[2]));
+    }
+
     /**
-     * @internal Member initalization occurs in the order of declaration in the
-     *      class (see ISO/IEC 14882:2003, Section 12.6.2). The order in the
-     *      init list is irrelevant. It is important that mStorage gets
-     *      initialized before the other members!
+     * @brief Bind to a transition state that is already given as an array
+     *
+     * This constructor does not allocate memory. It is used by the in-place
+     * transition function.
      */
-    TransitionState(AnyValue inArg)
-        : mStorage(inArg.copyIfImmutable()),
-          numRows(&mStorage[0]),
-          widthOfX(&mStorage[1]),
-          y_sum(&mStorage[2]),
-          y_square_sum(&mStorage[3]),
-          X_transp_Y(
-            TransparentHandle::create(&mStorage[4]),
-            widthOfX),
-          X_transp_X(
-            TransparentHandle::create(&mStorage[4 + widthOfX]),
-            widthOfX, widthOfX) { }
+    TransitionState(const Array<double> &inStorage)
+        : mStorage(inStorage) {
+        
+        rebind(static_cast<uint16_t>(mStorage[2]));
+    }
+
+    /**
+     * @brief Check whether an array is an initialized transition state (with at
+     *        least one row) for the given number of independent variables
+     */
+    static inline bool isInitialized(const Array<double> &inStorage,
+        const uint32_t inWidthOfX) {
+        
+        return inStorage.size() == arraySize(inWidthOfX)
+            && inStorage[0] == kLayout
+            && inStorage[1] > 0
+            && inStorage[2] == inWidthOfX;
+    }
+    
+    /**
+     * @brief Convert a state in the compact or the legacy layout into the
+     *        current layout
+     *
+     * States in the current layout and uninitialized states are returned
+     * unchanged (without copying).
+     */
+    static AnyValue upgrade(const AnyValue &inState,
+        AllocatorSPtr inAllocator) {
+        
+        Array_const<double> stored = inState;
+        
+        if (stored[0] == kLayout) {
+            uint16_t widthOfX = static_cast<uint16_t>(stored[2]);
+            if (stored.size() == arraySize(widthOfX))
+                return inState;
+            else if (stored.size() != compactSize(widthOfX))
+                throw std::invalid_argument("Invalid linear-regression "
+                    "state.");
+            
+            // Compact state: Append an empty row buffer
+            Array<double> storage(inAllocator,
+                boost::extents[ arraySize(widthOfX) ]);
+            std::copy(stored.data(), stored.data() + stored.size(),
+                storage.data());
+            std::fill(storage.data() + stored.size(),
+                storage.data() + storage.size(), 0.);
+            return storage;
+        }
+        
+        uint16_t widthOfX = static_cast<uint16_t>(stored[1]);
+        if (widthOfX == 0
+            || stored.size()
+                != 4 + widthOfX + static_cast<std::size_t>(widthOfX) * widthOfX)
+            return inState;
+        
+        Array<double> storage(inAllocator,
+            boost::extents[ arraySize(widthOfX) ]);
+        storage[0] = kLayout;
+        storage[2] = widthOfX;
+        
+        TransitionState state(storage);
+        state.numRows = static_cast<uint64_t>(stored[0]);
+        state.y_sum = stored[2];
+        state.y_square_sum = stored[3];
+        for (uint16_t i = 0; i < widthOfX; i++)
+            state.X_transp_Y(i) = stored[4 + i];
+        packUpperTriangle(widthOfX, stored.data() + 4 + widthOfX,
+            state.X_transp_X.memptr());
+        return state;
+    }
+
+    /**
+     * @brief Return the state in compact form, for persisting it
+     *
+     * The compact form omits the row buffer (buffered rows are added to
+     * X_transp_X). upgrade() converts it back. If there is no row buffer, the
+     * state is returned unchanged (without copying).
+     */
+    inline AnyValue compact(AllocatorSPtr inAllocator) const {
+        if (!bufferedRows.isEnabled())
+            return mStorage;
+        
+        uint16_t width = widthOfX;
+        Array<double> storage(inAllocator,
+            boost::extents[ compactSize(width) ]);
+        std::copy(mStorage.data(), mStorage.data() + storage.size(),
+            storage.data());
+        bufferedRows.addTo(storage.data() + 5 + width);
+        return storage;
+    }
+
+    /**
+     * @brief Number of doubles in a state for the given number of independent
+     *        variables
+     */
+    static inline uint32_t arraySize(const uint32_t inWidthOfX) {
+        return 5 + inWidthOfX + packedSize(inWidthOfX)
+            + GramBuffer::arraySize(inWidthOfX);
+    }
+
+    /**
+     * @brief Number of doubles in a state in compact form (without row buffer)
+     */
+    static inline uint32_t compactSize(const uint32_t inWidthOfX) {
+        return 5 + inWidthOfX + packedSize(inWidthOfX);
+    }
+
+    /**
+     * @brief Initialize a transition state in memory that is owned by the
+     *        caller and has already been zeroed
+     *
+     * The memory must hold compactSize(inWidthOfX) doubles. This is used for
+     * states embedded in other states (see GroupedLinearRegression).
+     */
+    static inline void initializeZeroed(double *ioStorage,
+        const uint16_t inWidthOfX) {
+        
+        ioStorage[0] = kLayout;
+        ioStorage[2] = inWidthOfX;
+    }
 
     /**
      * We define this function so that we can use TransitionState in the argument
@@ -78,16 +233,52 @@ public:
         const uint16_t inWidthOfX) {
         
         mStorage.rebind(inAllocator, boost::extents[ arraySize(inWidthOfX) ]);
-        numRows.rebind(&mStorage[0]) = 0;
-        widthOfX.rebind(&mStorage[1]) = inWidthOfX;
-        y_sum.rebind(&mStorage[2]) = 0;
-        y_square_sum.rebind(&mStorage[3]) = 0;
-        X_transp_Y.rebind(
-            TransparentHandle::create(&mStorage[4]),
-            inWidthOfX);
-        X_transp_X.rebind(
-            TransparentHandle::create(&mStorage[4 + inWidthOfX]),
-            inWidthOfX, inWidthOfX);
+        rebind(inWidthOfX);
+        mStorage[0] = kLayout;
+        numRows = 0;
+        widthOfX = inWidthOfX;
+        y_sum = 0;
+        y_square_sum = 0;
+        X_transp_Y.zeros();
+        X_transp_X.zeros();
+        bufferedRows.clear();
+    }
+    
+    /**
+     * @brief Add a row to the transition state
+     *
+     * @internal We deliberately do not use Armadillo expressions like
+     *     <tt>trans(x) * x</tt> here because they would create temporaries on
+     *     the heap for every row.
+     */
+    inline void update(double inY, const arma::rowvec &inX) {
+        const double *x = inX.memptr();
+        double *xTy = X_transp_Y.memptr();
+        uint16_t width = widthOfX;
+        
+        numRows++;
+        y_sum += inY;
+        y_square_sum += inY * inY;
+        for (uint16_t j = 0; j < width; j++)
+            xTy[j] += x[j] * inY;
+        
+        if (bufferedRows.isEnabled())
+            bufferedRows.push(x, 1., X_transp_X.memptr());
+        else
+            symmetricRankOneUpdate(width, 1., x, X_transp_X.memptr());
+    }
+    
+    /**
+     * @brief Return the full matrix \f$ X^T X \f$, including buffered rows
+     */
+    inline mat gramMatrix() const {
+        uint16_t width = widthOfX;
+        arma::colvec packed = X_transp_X;
+        bufferedRows.addTo(packed.memptr());
+        
+        mat result(width, width);
+        unpackSymmetric(width, packed.memptr(), result.memptr());
+        return result;
     }
     
     /**
@@ -96,17 +287,45 @@ public:
     TransitionState &operator+=(const TransitionState &inOtherState) {
         if (mStorage.size() != inOtherState.mStorage.size())
             throw std::logic_error("Internal error: Incompatible transition states");
-            
-        for (uint32_t i = 0; i < mStorage.size(); i++)
+        
+        // The layout marker and the row buffers must not be added element-wise
+        uint32_t numSummaryElements = compactSize(widthOfX);
+        for (uint32_t i = 1; i < numSummaryElements; i++)
             mStorage[i] += inOtherState.mStorage[i];
         
         widthOfX = inOtherState.widthOfX;
+        inOtherState.bufferedRows.addTo(X_transp_X.memptr());
         return *this;
     }
         
 private:
-    static inline uint32_t arraySize(const uint16_t inWidthOfX) {
-        return 4 + inWidthOfX + inWidthOfX * inWidthOfX;
+    /**
+     * @brief Marker in element 0 of states in the current layout (version 2)
+     *
+     * It is negative so that it cannot be confused with the numRows field that
+     * legacy states have in element 0. (Uninitialized states are all 0.)
+     */
+    static const int kLayout = -2;
+
+    /**
+     * @brief Rebind all views to the current storage array
+     */
+    inline void rebind(uint16_t inWidthOfX) {
+        numRows.rebind(&mStorage[1]);
+        widthOfX.rebind(&mStorage[2]);
+        y_sum.rebind(&mStorage[3]);
+        y_square_sum.rebind(&mStorage[4]);
+        X_transp_Y.rebind(mStorage.data() + 5, inWidthOfX);
+        X_transp_X.rebind(mStorage.data() + 5 + inWidthOfX,
+            packedSize(inWidthOfX));
+        
+        // States in compact form have no room for a row buffer
+        if (mStorage.size() < arraySize(inWidthOfX))
+            bufferedRows.disable();
+        else
+            bufferedRows.rebind(
+                mStorage.data() + 5 + inWidthOfX + packedSize(inWidthOfX),
+                inWidthOfX);
     }
 
     Array<double> mStorage;
@@ -117,7 +336,8 @@ public:
     Reference<double> y_sum;
     Reference<double> y_square_sum;
     DoubleCol X_transp_Y;
-    DoubleMat X_transp_X;
+    DoubleCol X_transp_X;
+    GramBuffer bufferedRows;
 };
 
 /**
@@ -134,12 +354,13 @@ AnyValue LinearRegression::transition(AbstractDBInterface &db, AnyValue args) {
     // instantiated from the respective <tt>_const</tt> class. Otherwise, the
     // abstraction layer will perform a deep copy (i.e., waste unnecessary
     // processor cycles).
-    TransitionState state = *arg++;
+    TransitionState state = TransitionState::upgrade(*arg++,
+        db.allocator(AbstractAllocator::kAggregate));
     double y = *arg++;
     DoubleRow_const x = *arg++;
     
     // See MADLIB-138. At least on certain platforms and with certain versions,
-    // LAPACK will run into an infinite loop if pinv() is called for non-finite
+    // LAPACK will run into an infinite loop if it is called for non-finite
     // matrices. We extend the check also to the dependent variables.
     if (!boost::math::isfinite(y))
         throw std::invalid_argument("Dependent variables are not finite.");
@@ -149,21 +370,55 @@ AnyValue LinearRegression::transition(AbstractDBInterface &db, AnyValue args) {
     // Now do the transition step.
     if (state.numRows == 0)
         state.initialize(db.allocator(AbstractAllocator::kAggregate), x.n_elem);
-    state.numRows++;
-    state.y_sum += y;
-    state.y_square_sum += y * y;
-    state.X_transp_Y += trans(x) * y;
-    state.X_transp_X += trans(x) * x;
+    else if (x.n_elem != state.widthOfX)
+        throw std::invalid_argument("Inconsistent numbers of independent "
+            "variables.");
+    state.update(y, x);
         
     return state;
 }
 
+/**
+ * @brief Perform the linear-regression transition step without allocating
+ *        memory
+ *
+ * This is the fast path for all but the first row: The transition state is
+ * modified in-place. We return false (and let transition() handle the call)
+ * whenever the state is not yet initialized or anything else is unusual.
+ */
+bool LinearRegression::transitionInPlace(const RawArgument *inArgs,
+    uint16_t inNumArgs) {
+    
+    if (!TransitionArgs::accepts(inArgs, inNumArgs))
+        return false;
+    
+    TransitionArgs args(inArgs, inNumArgs);
+    const Array<double> &storage = args.get<0>();
+    double y = args.get<1>();
+    const DoubleRow_const &x = args.get<2>();
+    
+    if (!TransitionState::isInitialized(storage, x.n_elem))
+        return false;
+    
+    if (!boost::math::isfinite(y))
+        throw std::invalid_argument("Dependent variables are not finite.");
+    else if (!x.is_finite())
+        throw std::invalid_argument("Design matrix is not finite.");
+    
+    TransitionState state(storage);
+    state.update(y, x);
+    return true;
+}
+
 /**
  * @brief Perform the perliminary aggregation function: Merge transition states
  */
 AnyValue LinearRegression::mergeStates(AbstractDBInterface &db, AnyValue args) {
-    TransitionState stateLeft = args[0].copyIfImmutable();
-    const TransitionState stateRight = args[1];
+    TransitionState stateLeft = TransitionState::upgrade(
+        args[0], db.allocator(AbstractAllocator::kAggregate)
+    ).copyIfImmutable();
+    const TransitionState stateRight = TransitionState::upgrade(args[1],
+        db.allocator());
     
     // We first handle the trivial case where this function is called with one
     // of the states being the initial state
@@ -178,50 +433,502 @@ AnyValue LinearRegression::mergeStates(AbstractDBInterface &db, AnyValue args) {
 }
 
 /**
- * @brief Perform the linear-regression final step
+ * @brief Return a transition state in compact form, for persisting it
+ *
+ * This is the final function of the aggregate that computes a state that can
+ * later be updated with new rows (see updateState()).
  */
-AnyValue LinearRegression::final(AbstractDBInterface &db, AnyValue args) {
-    const TransitionState state = args[0];
+AnyValue LinearRegression::compactState(AbstractDBInterface &db,
+    AnyValue args) {
+    
+    const TransitionState state = TransitionState::upgrade(args[0],
+        db.allocator());
+    
+    return state.compact(db.allocator());
+}
+
+/**
+ * @brief Merge a persisted state with the state of new rows
+ *
+ * Unlike mergeStates(), this is not called from an aggregate (or as the
+ * transition function of an aggregate that merges persisted states), so we
+ * must not use aggregate memory. The result is in compact form.
+ */
+AnyValue LinearRegression::updateState(AbstractDBInterface &db,
+    AnyValue args) {
+    
+    TransitionState state = TransitionState::upgrade(args[0], db.allocator());
+    const TransitionState newState = TransitionState::upgrade(args[1],
+        db.allocator());
+    
+    if (state.numRows == 0)
+        return newState.compact(db.allocator());
+    else if (newState.numRows == 0)
+        return state.compact(db.allocator());
+    else if (state.widthOfX != newState.widthOfX)
+        throw std::invalid_argument("Inconsistent numbers of independent "
+            "variables.");
+    
+    state += newState;
+    return state.compact(db.allocator());
+}
+
+/**
+ * @brief Transition state for grouped linear-regression functions
+ *
+ * The grouped aggregate computes a separate linear regression for each group.
+ * To the database, the state is a single DOUBLE PRECISION array (allocated in
+ * the aggregate context). To the C++ code, it is an arena holding an
+ * open-addressing hash map from group keys to LinearRegression::TransitionState
+ * objects. Hence, there is no per-group overhead in the executor, and no
+ * per-group array is copied.
+ *
+ * The hash map uses linear probing. Each bucket of the index contains 0 if it
+ * is empty, and the number of the group plus 1 otherwise. The states of all
+ * groups are laid out contiguously, in the order in which the groups were first
+ * seen. There is room for capacity / 2 groups, so that the load factor of the
+ * index is at most 1/2. If a new group does not fit any more, the arena is
+ * reallocated with twice the capacity.
+ *
+ * Group keys are stored as doubles, so their absolute value must not exceed
+ * \f$ 2^{53} \f$.
+ *
+ * Note: We assume that the DOUBLE PRECISION array is initialized by the
+ * database with length at least 4, and all elemenets are 0.
+ *
+ * @internal Array layout:
+ * - 0: layout (kGroupedLayout, or 0 if not yet initialized)
+ * - 1: widthOfX (number of independent variables)
+ * - 2: numGroups (number of groups)
+ * - 3: capacity (number of buckets in the index, a power of 2)
+ * - 4: index (capacity buckets)
+ * - 4 + capacity: groups (capacity / 2 slots, each consisting of the group key
+ *   followed by a LinearRegression::TransitionState in compact form)
+ *
+ * The group states have no row buffer: With many groups, a buffer would make
+ * up most of each slot (for wide designs), and buffered rows would rarely fill
+ * a block anyway. Since the arena is a single array, its size is limited by
+ * the maximum size of an allocation in the database (kMaxArraySize).
+ */
+class GroupedLinearRegression::TransitionState {
+public:
+    TransitionState(AnyValue inArg)
+        : mStorage(inArg.copyIfImmutable()) {
+        
+        rebind();
+    }
+
+    /**
+     * @brief Bind to a transition state that is already given as an array
+     *
+     * This constructor does not allocate memory. It is used by the in-place
+     * transition function.
+     */
+    TransitionState(const Array<double> &inStorage)
+        : mStorage(inStorage) {
+        
+        rebind();
+    }
+
+    /**
+     * @brief Check whether an array is an initialized transition state for
+     *        the given number of independent variables
+     */
+    static inline bool isInitialized(const Array<double> &inStorage,
+        const uint32_t inWidthOfX) {
+        
+        return inStorage.size() >= kHeaderSize
+            && inStorage[0] == kGroupedLayout
+            && inStorage[1] == inWidthOfX
+            && inStorage.size() == arraySize(inWidthOfX,
+                static_cast<uint32_t>(inStorage[3]));
+    }
+
+    /**
+     * @brief Convert a group key into the representation used in the state
+     */
+    static inline double groupKey(const int64_t inGroupKey) {
+        const int64_t kMaxGroupKey = static_cast<int64_t>(1) << 53;
+        
+        if (inGroupKey > kMaxGroupKey || inGroupKey < -kMaxGroupKey)
+            throw std::invalid_argument("Group keys must not exceed 2^53 in "
+                "absolute value.");
+        return static_cast<double>(inGroupKey);
+    }
+
+    /**
+     * We define this function so that we can use TransitionState in the argument
+     * list and as a return type.
+     */
+    inline operator AnyValue() const {
+        return mStorage;
+    }
+    
+    inline bool isInitialized() const {
+        return mStorage[0] == kGroupedLayout;
+    }
+
+    /**
+     * @brief Initialize the transition state. Only called for first row.
+     */
+    inline void initialize(AllocatorSPtr inAllocator,
+        const uint16_t inWidthOfX) {
+        
+        allocate(inAllocator, inWidthOfX, kInitialCapacity);
+    }
+
+    /**
+     * @brief Return the slot of a group, and insert the group if it is new
+     *
+     * @return The slot, or NULL if the group is new and there is no room left.
+     *     In the latter case, the caller needs to call grow() first.
+     */
+    inline double *findOrInsert(const double inGroupKey) {
+        uint32_t bucket;
+        double *slot = find(inGroupKey, bucket);
+        
+        if (slot == NULL && numGroups < capacity / 2) {
+            slot = this->slot(numGroups);
+            std::fill(slot, slot + slotSize(widthOfX), 0.);
+            slot[0] = inGroupKey;
+            LinearRegression::TransitionState::initializeZeroed(slot + 1,
+                widthOfX);
+            numGroups++;
+            mIndex[bucket] = numGroups;
+        }
+        return slot;
+    }
+
+    /**
+     * @brief Return the slot of a group, and insert the group if it is new,
+     *        growing the arena if necessary
+     */
+    inline double *findOrInsert(AllocatorSPtr inAllocator,
+        const double inGroupKey) {
+        
+        double *slot = findOrInsert(inGroupKey);
+        if (slot == NULL) {
+            grow(inAllocator);
+            slot = findOrInsert(inGroupKey);
+        }
+        return slot;
+    }
+
+    /**
+     * @brief Return the slot of the group with the given number
+     */
+    inline double *slot(const uint32_t inGroup) const {
+        return const_cast<double*>(mStorage.data()) + kHeaderSize + capacity
+            + static_cast<std::size_t>(inGroup) * slotSize(widthOfX);
+    }
+
+    /**
+     * @brief Return the storage of the linear-regression state in a slot
+     *
+     * The returned array is only a view (it does not own the memory).
+     */
+    inline Array<double> groupStorage(double *inSlot) const {
+        return Array<double>(inSlot + 1,
+            boost::extents[
+                LinearRegression::TransitionState::compactSize(widthOfX) ]);
+    }
+
+    /**
+     * @brief Merge with another TransitionState object
+     */
+    void merge(AllocatorSPtr inAllocator,
+        const TransitionState &inOtherState) {
+        
+        if (widthOfX != inOtherState.widthOfX)
+            throw std::invalid_argument("Inconsistent numbers of independent "
+                "variables.");
+        
+        for (uint32_t i = 0; i < inOtherState.numGroups; i++) {
+            double *otherSlot = inOtherState.slot(i);
+            LinearRegression::TransitionState group(
+                groupStorage(findOrInsert(inAllocator, otherSlot[0])));
+            group += LinearRegression::TransitionState(
+                inOtherState.groupStorage(otherSlot));
+        }
+    }
+
+private:
+    /**
+     * @brief Marker in element 0 of initialized states
+     */
+    static const int kGroupedLayout = -3;
+
+    enum {
+        kHeaderSize = 4,
+        kInitialCapacity = 16
+    };
+
+    /**
+     * @brief Maximum number of doubles in the arena
+     *
+     * PostgreSQL does not allocate more than 1 GB at once (MaxAllocSize). We
+     * leave some room for the array header.
+     */
+    static const std::size_t kMaxArraySize
+        = ((static_cast<std::size_t>(1) << 30) - 1024) / sizeof(double);
+
+    static inline std::size_t slotSize(const uint32_t inWidthOfX) {
+        return 1 + LinearRegression::TransitionState::compactSize(inWidthOfX);
+    }
+
+    static inline std::size_t arraySize(const uint32_t inWidthOfX,
+        const uint32_t inCapacity) {
+        
+        return kHeaderSize + inCapacity
+            + static_cast<std::size_t>(inCapacity / 2) * slotSize(inWidthOfX);
+    }
+
+    /**
+     * @brief Hash function for group keys
+     *
+     * Group keys are often consecutive integers, so we need good mixing of
+     * all bits. This is the finalizer of MurmurHash3.
+     */
+    static inline uint32_t hash(const double inGroupKey) {
+        uint64_t h = static_cast<uint64_t>(static_cast<int64_t>(inGroupKey));
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return static_cast<uint32_t>(h);
+    }
+
+    /**
+     * @brief Return the slot of a group, or NULL if the group is not in the
+     *        hash map
+     *
+     * @param inGroupKey The group key
+     * @param outBucket If the group is not in the hash map, the (empty) bucket
+     *     where it should be inserted
+     */
+    inline double *find(const double inGroupKey, uint32_t &outBucket) const {
+        const uint32_t mask = capacity - 1;
+        
+        // This loop terminates because the load factor is at most 1/2
+        for (uint32_t bucket = hash(inGroupKey) & mask; ;
+            bucket = (bucket + 1) & mask) {
+            
+            uint32_t entry = static_cast<uint32_t>(mIndex[bucket]);
+            if (entry == 0) {
+                outBucket = bucket;
+                return NULL;
+            }
+            
+            double *slot = this->slot(entry - 1);
+            if (slot[0] == inGroupKey)
+                return slot;
+        }
+    }
+
+    /**
+     * @brief Allocate a new, empty arena
+     */
+    inline void allocate(AllocatorSPtr inAllocator, const uint16_t inWidthOfX,
+        const uint32_t inCapacity) {
+        
+        mStorage.rebind(inAllocator,
+            boost::extents[ arraySize(inWidthOfX, inCapacity) ]);
+        std::fill(mStorage.data(), mStorage.data() + kHeaderSize + inCapacity,
+            0.);
+        rebind();
+        mStorage[0] = kGroupedLayout;
+        widthOfX = inWidthOfX;
+        numGroups = 0;
+        capacity = inCapacity;
+    }
+
+    /**
+     * @brief Reallocate the arena with twice the capacity
+     *
+     * The group states are copied as one contiguous block. Only the index
+     * needs to be rebuilt.
+     */
+    void grow(AllocatorSPtr inAllocator) {
+        // Array copies are shallow, so this only keeps the old arena alive
+        Array<double> oldStorage(mStorage);
+        const double *oldGroups = slot(0);
+        const uint32_t oldNumGroups = numGroups;
+        const uint16_t width = widthOfX;
+        
+        if (arraySize(width, 2 * capacity) > kMaxArraySize) {
+            std::stringstream message;
+            message << "Too many groups for linregr_grouped(): The states of "
+                "more than " << oldNumGroups << " groups with " << width
+                << " independent variables exceed the maximum size of an "
+                "aggregate state. Use linregr() with GROUP BY instead.";
+            throw std::runtime_error(message.str());
+        }
+        
+        allocate(inAllocator, width, 2 * capacity);
+        std::copy(oldGroups, oldGroups + oldNumGroups * slotSize(width),
+            slot(0));
+        numGroups = oldNumGroups;
+        
+        for (uint32_t i = 0; i < oldNumGroups; i++) {
+            uint32_t bucket;
+            find(slot(i)[0], bucket);
+            mIndex[bucket] = i + 1;
+        }
+    }
+
+    /**
+     * @brief Rebind all views to the current storage array
+     */
+    inline void rebind() {
+        widthOfX.rebind(&mStorage[1]);
+        numGroups.rebind(&mStorage[2]);
+        capacity.rebind(&mStorage[3]);
+        mIndex = mStorage.data() + kHeaderSize;
+    }
+
+    Array<double> mStorage;
+    double *mIndex;
+
+public:
+    Reference<double, uint16_t> widthOfX;
+    Reference<double, uint32_t> numGroups;
+    Reference<double, uint32_t> capacity;
+};
+
+/**
+ * @brief Perform the grouped linear-regression transition step
+ *
+ * The arguments are the state, the group key, the dependent variable, and the
+ * vector of independent variables.
+ */
+AnyValue GroupedLinearRegression::transition(AbstractDBInterface &db,
+    AnyValue args) {
+    
+    AnyValue::iterator arg(args);
+    
+    TransitionState state = *arg++;
+    double groupKey = TransitionState::groupKey(*arg++);
+    double y = *arg++;
+    DoubleRow_const x = *arg++;
+    
+    if (!boost::math::isfinite(y))
+        throw std::invalid_argument("Dependent variables are not finite.");
+    else if (!x.is_finite())
+        throw std::invalid_argument("Design matrix is not finite.");
+    
+    if (!state.isInitialized())
+        state.initialize(db.allocator(AbstractAllocator::kAggregate), x.n_elem);
+    else if (x.n_elem != state.widthOfX)
+        throw std::invalid_argument("Inconsistent numbers of independent "
+            "variables.");
+    
+    LinearRegression::TransitionState group(state.groupStorage(
+        state.findOrInsert(db.allocator(AbstractAllocator::kAggregate),
+            groupKey)));
+    group.update(y, x);
+    
+    return state;
+}
+
+/**
+ * @brief Perform the grouped linear-regression transition step without
+ *        allocating memory
+ *
+ * As LinearRegression::transitionInPlace(). Rows of new groups are handled
+ * in-place as long as there is room left in the arena.
+ */
+bool GroupedLinearRegression::transitionInPlace(const RawArgument *inArgs,
+    uint16_t inNumArgs) {
+    
+    if (!TransitionArgs::accepts(inArgs, inNumArgs))
+        return false;
+    
+    TransitionArgs args(inArgs, inNumArgs);
+    const Array<double> &storage = args.get<0>();
+    double groupKey = TransitionState::groupKey(args.get<1>());
+    double y = args.get<2>();
+    const DoubleRow_const &x = args.get<3>();
+    
+    if (!TransitionState::isInitialized(storage, x.n_elem))
+        return false;
+    
+    if (!boost::math::isfinite(y))
+        throw std::invalid_argument("Dependent variables are not finite.");
+    else if (!x.is_finite())
+        throw std::invalid_argument("Design matrix is not finite.");
+    
+    TransitionState state(storage);
+    double *slot = state.findOrInsert(groupKey);
+    if (slot == NULL)
+        return false;
+    
+    LinearRegression::TransitionState group(state.groupStorage(slot));
+    group.update(y, x);
+    return true;
+}
+
+/**
+ * @brief Perform the perliminary aggregation function: Merge transition states
+ */
+AnyValue GroupedLinearRegression::mergeStates(AbstractDBInterface &db,
+    AnyValue args) {
+    
+    TransitionState stateLeft = args[0];
+    const TransitionState stateRight = args[1];
+    
+    // We first handle the trivial case where this function is called with one
+    // of the states being the initial state
+    if (!stateLeft.isInitialized())
+        return stateRight;
+    else if (!stateRight.isInitialized())
+        return stateLeft;
+    
+    stateLeft.merge(db.allocator(AbstractAllocator::kAggregate), stateRight);
+    return stateLeft;
+}
+
+/**
+ * @brief Compute the coefficients and diagnostic statistics of a state
+ *
+ * This function wraps the common parts of the final steps of the ungrouped and
+ * the grouped linear regression. All vectors must already be bound to memory
+ * for widthOfX elements.
+ *
+ * @return The condition number of \f$ X^T X \f$
+ */
+static double computeStatistics(
+    const LinearRegression::TransitionState &inState,
+    DoubleCol &outCoef,
+    double &outR2,
+    DoubleCol &outStdErr,
+    DoubleCol &outTStats,
+    DoubleCol &outPValues) {
 
     // See MADLIB-138. At least on certain platforms and with certain versions,
-    // LAPACK will run into an infinite loop if pinv() is called for non-finite
+    // LAPACK will run into an infinite loop if it is called for non-finite
     // matrices. We extend the check also to the dependent variables.
-    if (!state.X_transp_X.is_finite() || !state.X_transp_Y.is_finite())
+    if (!inState.X_transp_X.is_finite() || !inState.X_transp_Y.is_finite())
         throw std::invalid_argument("Design matrix is not finite.");
-        
-    // FIXME: We have essentially two calls to svd now (pinv calls svd, too).
-    // This is a waste of processor cycles and energy.
-    vec singularValues = svd(state.X_transp_X);
-    double condition_X_transp_X = max(singularValues) / min(singularValues);
-
-    // See:
-    // Lichtblau, Daniel and Weisstein, Eric W. "Condition Number."
-    // From MathWorld--A Wolfram Web Resource.
-    // http://mathworld.wolfram.com/ConditionNumber.html
-    if (condition_X_transp_X > 1000)
-        db.out << "Matrix X^T X is ill-conditioned (condition number "
-            "= " << condition_X_transp_X << "). "
-            "Expect strong multicollinerity." << std::endl;
     
-    // Precompute (X^T * X)^+
-    mat inverse_of_X_transp_X = pinv(state.X_transp_X);
+    // X^T X is symmetric positive semi-definite. One eigen decomposition gives
+    // us the condition number, the coefficients, and the diagonal of
+    // (X^T X)^+ that we need for the standard errors.
+    SymmetricPositiveDecomposition decomposition(inState.gramMatrix());
 
-    // Vector of coefficients: For efficiency reasons, we want to return this
-    // by reference, so we need to bind to db memory
-    DoubleCol coef(db.allocator(), state.widthOfX);
-    coef = inverse_of_X_transp_X * state.X_transp_Y;
+    outCoef = decomposition.solve(inState.X_transp_Y);
     
     // explained sum of squares (regression sum of squares)
     double ess
         = as_scalar(
-            trans(state.X_transp_Y) * coef
-            - ((state.y_sum * state.y_sum) / state.numRows)
+            trans(inState.X_transp_Y) * outCoef
+            - ((inState.y_sum * inState.y_sum) / inState.numRows)
           );
 
     // total sum of squares
     double tss
-        = state.y_square_sum
-            - ((state.y_sum * state.y_sum) / state.numRows);
+        = inState.y_square_sum
+            - ((inState.y_sum * inState.y_sum) / inState.numRows);
     
     // With infinite precision, the following checks are pointless. But due to
     // floating-point arithmetic, this need not hold at this point.
@@ -239,7 +946,7 @@ AnyValue LinearRegression::final(AbstractDBInterface &db, AnyValue args) {
     // coefficient of determination
     // If tss == 0, then the regression perfectly fits the data, so the
     // coefficient of determination is 1.
-    double r2 = (tss == 0 ? 1 : ess / tss);
+    outR2 = (tss == 0 ? 1 : ess / tss);
 
     // In the case of linear regression:
     // residual sum of squares (rss) = total sum of squares (tss) - explained
@@ -247,42 +954,82 @@ AnyValue LinearRegression::final(AbstractDBInterface &db, AnyValue args) {
     // Proof: http://en.wikipedia.org/wiki/Sum_of_squares
     double rss = tss - ess;
 
+    // Without more rows than coefficients, there are no degrees of freedom
+    // left to estimate the variance. (numRows and widthOfX are unsigned, so
+    // their difference would wrap around.) This is common for small groups in
+    // GroupedLinearRegression.
+    if (inState.numRows <= inState.widthOfX) {
+        outStdErr.fill(std::numeric_limits<double>::quiet_NaN());
+        outTStats.fill(std::numeric_limits<double>::quiet_NaN());
+        outPValues.fill(std::numeric_limits<double>::quiet_NaN());
+        return decomposition.conditionNo();
+    }
+    const uint64_t degreesOfFreedom = inState.numRows - inState.widthOfX;
+
     // Variance is also called the mean square error
-	double variance = rss / (state.numRows - state.widthOfX);
+    double variance = rss / degreesOfFreedom;
     
-    // Vector of standard errors and t-statistics: For efficiency reasons, we
-    // want to return these by reference, so we need to bind to db memory
-    DoubleCol stdErr(db.allocator(), state.widthOfX);
-    DoubleCol tStats(db.allocator(), state.widthOfX);
-    for (int i = 0; i < state.widthOfX; i++) {
+    vec diagonal_of_inverse = decomposition.pseudoInverseDiagonal();
+    for (int i = 0; i < inState.widthOfX; i++) {
         // In an abundance of caution, we see a tiny possibility that numerical
-        // instabilities in the pinv operation can lead to negative values on
+        // instabilities in the pseudo-inverse can lead to negative values on
         // the main diagonal of even a SPD matrix
-        if (inverse_of_X_transp_X(i,i) < 0) {
-            stdErr(i) = 0;
+        if (diagonal_of_inverse(i) < 0) {
+            outStdErr(i) = 0;
         } else {
-            stdErr(i) = std::sqrt( variance * inverse_of_X_transp_X(i,i) );
+            outStdErr(i) = std::sqrt( variance * diagonal_of_inverse(i) );
         }
         
-        if (coef(i) == 0 && stdErr(i) == 0) {
+        if (outCoef(i) == 0 && outStdErr(i) == 0) {
             // In this special case, 0/0 should be interpreted as 0:
             // We know that 0 is the exact value for the coefficient, so
             // the t-value should be 0 (corresponding to a p-value of 1)
-            tStats(i) = 0;
+            outTStats(i) = 0;
         } else {
             // If stdErr(i) == 0 then abs(tStats(i)) will be infinity, which is
             // what we need.
-            tStats(i) = coef(i) / stdErr(i);
+            outTStats(i) = outCoef(i) / outStdErr(i);
         }
     }
     
-    // Vector of p-values: For efficiency reasons, we want to return this
-    // by reference, so we need to bind to db memory
+    // Compute all p-values with one call, so that the coefficients of the
+    // Student-t series are computed only once
+    for (int i = 0; i < inState.widthOfX; i++)
+        outPValues(i) = std::fabs( outTStats(i) );
+    studentT_cdf(degreesOfFreedom, outPValues.memptr(),
+        outPValues.memptr(), inState.widthOfX);
+    for (int i = 0; i < inState.widthOfX; i++)
+        outPValues(i) = 2. * (1. - outPValues(i));
+    
+    return decomposition.conditionNo();
+}
+
+/**
+ * @brief Perform the linear-regression final step
+ */
+AnyValue LinearRegression::final(AbstractDBInterface &db, AnyValue args) {
+    const TransitionState state = TransitionState::upgrade(args[0],
+        db.allocator());
+
+    // Vectors of coefficients, standard errors, t-statistics, and p-values:
+    // For efficiency reasons, we want to return these by reference, so we
+    // need to bind to db memory
+    DoubleCol coef(db.allocator(), state.widthOfX);
+    double r2;
+    DoubleCol stdErr(db.allocator(), state.widthOfX);
+    DoubleCol tStats(db.allocator(), state.widthOfX);
     DoubleCol pValues(db.allocator(), state.widthOfX);
-    for (int i = 0; i < state.widthOfX; i++)
-        pValues(i) = 2. * (1. - studentT_cdf(
-                                    state.numRows - state.widthOfX,
-                                    std::fabs( tStats(i) )));
+    double condition_X_transp_X = computeStatistics(state, coef, r2, stdErr,
+        tStats, pValues);
+
+    // See:
+    // Lichtblau, Daniel and Weisstein, Eric W. "Condition Number."
+    // From MathWorld--A Wolfram Web Resource.
+    // http://mathworld.wolfram.com/ConditionNumber.html
+    if (condition_X_transp_X > 1000)
+        db.out << "Matrix X^T X is ill-conditioned (condition number "
+            "= " << condition_X_transp_X << "). "
+            "Expect strong multicollinerity." << std::endl;
     
     // Return all coefficients, standard errors, etc. in a tuple
     AnyValueVector tuple;
@@ -297,6 +1044,71 @@ AnyValue LinearRegression::final(AbstractDBInterface &db, AnyValue args) {
     return tuple;
 }
 
+/**
+ * @brief Perform the grouped linear-regression final step
+ *
+ * All results are returned in one pass, as arrays with one element (or, for
+ * coefficients and statistics, widthOfX consecutive elements) per group. The
+ * SQL function linregr_grouped_unnest() turns them into one row per group.
+ */
+AnyValue GroupedLinearRegression::final(AbstractDBInterface &db,
+    AnyValue args) {
+    
+    const TransitionState state = args[0];
+    uint32_t numGroups = 0;
+    uint16_t widthOfX = 0;
+    if (state.isInitialized()) {
+        numGroups = state.numGroups;
+        widthOfX = state.widthOfX;
+    }
+
+    DoubleCol groupKeys(db.allocator(), numGroups);
+    DoubleCol numRows(db.allocator(), numGroups);
+    DoubleCol coef(db.allocator(), numGroups * widthOfX);
+    DoubleCol r2(db.allocator(), numGroups);
+    DoubleCol stdErr(db.allocator(), numGroups * widthOfX);
+    DoubleCol tStats(db.allocator(), numGroups * widthOfX);
+    DoubleCol pValues(db.allocator(), numGroups * widthOfX);
+    DoubleCol conditionNo(db.allocator(), numGroups);
+    
+    // Views on the part of the result arrays that belongs to one group
+    DoubleCol groupCoef;
+    DoubleCol groupStdErr;
+    DoubleCol groupTStats;
+    DoubleCol groupPValues;
+    
+    for (uint32_t i = 0; i < numGroups; i++) {
+        double *slot = state.slot(i);
+        const LinearRegression::TransitionState group(
+            state.groupStorage(slot));
+        std::size_t offset = static_cast<std::size_t>(i) * widthOfX;
+        
+        groupCoef.rebind(coef.memptr() + offset, widthOfX);
+        groupStdErr.rebind(stdErr.memptr() + offset, widthOfX);
+        groupTStats.rebind(tStats.memptr() + offset, widthOfX);
+        groupPValues.rebind(pValues.memptr() + offset, widthOfX);
+        
+        groupKeys(i) = slot[0];
+        numRows(i) = group.numRows;
+        conditionNo(i) = computeStatistics(group, groupCoef, r2(i),
+            groupStdErr, groupTStats, groupPValues);
+    }
+    
+    AnyValueVector tuple;
+    ConcreteRecord::iterator tupleElement(tuple);
+    
+    tupleElement++ = groupKeys;
+    tupleElement++ = numRows;
+    tupleElement++ = coef;
+    tupleElement++ = r2;
+    tupleElement++ = stdErr;
+    tupleElement++ = tStats;
+    tupleElement++ = pValues;
+    tupleElement++ = conditionNo;
+    
+    return tuple;
+}
+
 } // namespace regress
 
 } // namespace modules
@@ -22,8 +22,28 @@ struct LinearRegression {
     enum What { kCoef, kRSquare, kTStats, kPValues };
     
     class TransitionState;
+    typedef Args<Array<double>, double, DoubleRow_const> TransitionArgs;
     
     static AnyValue transition(AbstractDBInterface &db, AnyValue args);
+    static bool transitionInPlace(const RawArgument *inArgs,
+        uint16_t inNumArgs);
+    static AnyValue mergeStates(AbstractDBInterface &db, AnyValue args);
+    static AnyValue final(AbstractDBInterface &db, AnyValue args);
+    static AnyValue compactState(AbstractDBInterface &db, AnyValue args);
+    static AnyValue updateState(AbstractDBInterface &db, AnyValue args);
+};
+
+/**
+ * @brief Linear-regression functions for many groups in one aggregate
+ */
+struct GroupedLinearRegression {
+    class TransitionState;
+    typedef Args<Array<double>, int64_t, double, DoubleRow_const>
+        TransitionArgs;
+    
+    static AnyValue transition(AbstractDBInterface &db, AnyValue args);
+    static bool transitionInPlace(const RawArgument *inArgs,
+        uint16_t inNumArgs);
     static AnyValue mergeStates(AbstractDBInterface &db, AnyValue args);
     static AnyValue final(AbstractDBInterface &db, AnyValue args);
 };
@@ -4,13 +4,17 @@
  *
  * @brief Logistic-Regression functions
  *
- * We implement the conjugate-gradient method and the iteratively-reweighted-
- * least-squares method.
+ * We implement the conjugate-gradient method, the iteratively-reweighted-
+ * least-squares method, and incremental gradient descent.
  *
  *//* ----------------------------------------------------------------------- */
 
 #include <modules/regress/logistic.hpp>
+#include <modules/regress/design_matrix.hpp>
 #include <utils/Reference.hpp>
+#include <utils/GramBuffer.hpp>
+#include <utils/packedSymmetric.hpp>
+#include <utils/SymmetricPositiveDecomposition.hpp>
 
 // Floating-point classification functions are in C99 and TR1, but not in the
 // official C++ Standard (before C++0x). We therefore use the Boost implementation
@@ -23,6 +27,9 @@
 // distributed.
 #include <boost/math/distributions/chi_squared.hpp>
 
+#include <algorithm>
+#include <limits>
+
 
 // Import names from Armadillo
 using arma::mat;
@@ -34,6 +41,12 @@ using arma::as_scalar;
 namespace madlib {
 
 using utils::Reference;
+using utils::GramBuffer;
+using utils::packedSize;
+using utils::symmetricRankOneUpdate;
+using utils::unpackSymmetric;
+using utils::packUpperTriangle;
+using utils::SymmetricPositiveDecomposition;
 
 namespace modules {
 
@@ -43,7 +56,140 @@ namespace regress {
 AnyValue stateToResult(AbstractDBInterface &db,
     const DoubleCol &inCoef,
     const double &inLogLikelihood,
-    const mat &inInverse_of_X_transp_AX);
+    const SymmetricPositiveDecomposition &inX_transp_AX);
+
+/**
+ * @brief Maximum number of rows that the transition functions process at once
+ */
+static const uint32_t kRowBlockSize = 16;
+
+/**
+ * @brief Dot product of two vectors
+ *
+ * We use four independent partial sums, so that the compiler may use SIMD
+ * instructions without having to reorder floating-point additions.
+ */
+static inline double dot(uint16_t inN, const double *inX, const double *inY) {
+    double sum[4] = { 0, 0, 0, 0 };
+    uint16_t i = 0;
+
+    for (; i + 4 <= inN; i += 4) {
+        sum[0] += inX[i] * inY[i];
+        sum[1] += inX[i + 1] * inY[i + 1];
+        sum[2] += inX[i + 2] * inY[i + 2];
+        sum[3] += inX[i + 3] * inY[i + 3];
+    }
+    for (; i < inN; i++)
+        sum[0] += inX[i] * inY[i];
+    return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+}
+
+/**
+ * @brief Return \f$ \ln(1 + \exp(-m)) \f$ without overflow
+ *
+ * We use \f$ \ln(1 + \exp(-m)) = \ln(1 + \exp(-|m|)) + \max(-m, 0) \f$.
+ */
+static inline double logLikelihoodTerm(double m) {
+    return std::log(1. + std::exp(-std::fabs(m))) + (m < 0 ? -m : 0.);
+}
+
+/**
+ * @brief Compute the row-wise scalars of the logistic-regression transition
+ *        step for a block of rows
+ *
+ * With the logistic function \f$ \sigma(x) = 1 / (1 + \exp(-x)) \f$, we
+ * compute for all rows \f$ i \f$:
+ * - <tt>outA[i]</tt> \f$ = a_i = \sigma(x_i c) \sigma(-x_i c) \f$
+ * - <tt>outGradScale[i]</tt> \f$ = \sigma(-y_i x_i c) y_i \f$
+ *
+ * and return \f$ \sum_i \ln(1 + \exp(-y_i x_i c)) \f$.
+ *
+ * Since \f$ \sigma(-x) = 1 - \sigma(x) \f$, all of these are functions of
+ * \f$ u = \exp(-|x_i c|) \f$: We have \f$ \sigma(|x_i c|) = 1 / (1 + u) \f$,
+ * \f$ \sigma(-|x_i c|) = u / (1 + u) \f$, \f$ a_i = u / (1 + u)^2 \f$, and
+ * \f$ \ln(1 + \exp(-m)) = \ln(1 + u) + \max(-m, 0) \f$ for
+ * \f$ m = y_i x_i c \f$. So one exp() and one log() per row suffice, instead of
+ * five exp() and one log(). Unlike \f$ \ln(1 + \exp(-m)) \f$, the
+ * expression also does not overflow for large \f$ -m \f$. The loop has no
+ * dependencies between rows, so compilers that provide vectorized exp() and
+ * log() can vectorize it.
+ *
+ * @param inNumRows Number of rows (at most kRowBlockSize)
+ * @param inY Dependent variables \f$ y_i \in \{ -1, 1 \} \f$
+ * @param inXc Linear predictors \f$ x_i c \f$
+ * @param outA Memory for the \f$ a_i \f$
+ * @param outGradScale Memory for the factors of the gradient
+ */
+static inline double logisticTerms(uint32_t inNumRows, const double *inY,
+    const double *inXc, double *outA, double *outGradScale) {
+    
+    double logTerms = 0;
+    
+    for (uint32_t i = 0; i < inNumRows; i++) {
+        double m = inY[i] * inXc[i];
+        double u = std::exp(-std::fabs(m));
+        double sigmaOfAbs = 1. / (1. + u);
+        
+        outA[i] = u * sigmaOfAbs * sigmaOfAbs;
+        outGradScale[i] = (m >= 0 ? u * sigmaOfAbs : sigmaOfAbs) * inY[i];
+        logTerms += std::log(1. + u) + (m < 0 ? -m : 0.);
+    }
+    return logTerms;
+}
+
+/**
+ * @brief Perform the logistic-regression transition step for all rows of a
+ *        block from the design-matrix cache (see DesignMatrixBlock)
+ *
+ * The state is initialized exactly as by the per-row transition functions.
+ * The arguments are the state, the block, and the previous state.
+ */
+template <class State>
+static AnyValue transitionFromBlock(AbstractDBInterface &db, AnyValue args) {
+    AnyValue::iterator arg(args);
+    
+    State state = State::upgrade(*arg++,
+        db.allocator(AbstractAllocator::kAggregate));
+    Array_const<double> block = *arg++;
+    uint32_t numRows = static_cast<uint32_t>(block[0]);
+    uint16_t widthOfX = static_cast<uint16_t>(block[1]);
+    if (numRows == 0)
+        return state;
+    
+    // See MADLIB-138. At least on certain platforms and with certain versions,
+    // LAPACK will run into an infinite loop if it is called for non-finite
+    // matrices. We extend the check also to the dependent variables.
+    if (!DoubleCol_const(block.data(), block.size()).is_finite())
+        throw std::invalid_argument("Design matrix is not finite.");
+    
+    if (state.numRows == 0) {
+        state.initialize(db.allocator(AbstractAllocator::kAggregate), widthOfX);
+        if (!arg->isNull()) {
+            const State previousState = State::upgrade(*arg,
+                db.allocator());
+            
+            state = previousState;
+            state.reset();
+        }
+    }
+    
+    if (widthOfX != state.widthOfX)
+        throw std::invalid_argument("Inconsistent numbers of independent "
+            "variables.");
+    
+    const double *record = block.data() + DesignMatrixBlock::kHeaderSize;
+    double y[kRowBlockSize];
+    const double *x[kRowBlockSize];
+    for (uint32_t begin = 0; begin < numRows; begin += kRowBlockSize) {
+        uint32_t blockSize = std::min(kRowBlockSize, numRows - begin);
+        for (uint32_t i = 0; i < blockSize; i++, record += 1 + widthOfX) {
+            y[i] = record[0] != 0 ? 1. : -1.;
+            x[i] = record + 1;
+        }
+        state.update(blockSize, y, x);
+    }
+    return state;
+}
 
 /**
  * @brief Inter- and intra-iteration state for conjugate-gradient method for
@@ -55,46 +201,113 @@ AnyValue stateToResult(AbstractDBInterface &db,
  * object containing scalars and vectors.
  *
  * Note: We assume that the DOUBLE PRECISION array is initialized by the
- * database with length at least 5, and all elemenets are 0.
+ * database with length at least 6, and all elemenets are 0.
+ *
+ * The symmetric matrix \f$ X^T A X \f$ is stored as packed upper triangle (see
+ * packedSymmetric.hpp).
+ *
+ * @internal Array layout, version 2 (iteration refers to one aggregate-function
+ * call):
+ * - 0: layout (always kLayout)
  *
- * @internal Array layout (iteration refers to one aggregate-function call):
  * Inter-iteration components (updated in final function):
- * - 0: iteration (current iteration)
- * - 1: widthOfX (number of coefficients)
- * - 2: coef (vector of coefficients)
- * - 2 + widthOfX: dir (direction)
- * - 2 + 2 * widthOfX: grad (gradient)
- * - 2 + 3 * widthOfX: beta (scale factor)
+ * - 1: iteration (current iteration)
+ * - 2: widthOfX (number of coefficients)
+ * - 3: beta (scale factor)
+ *
+ * Intra-iteration components (updated in transition step):
+ * - 4: numRows (number of rows already processed in this iteration)
+ * - 5: logLikelihood ( ln(l(c)) )
+ *
+ * Inter-iteration components (updated in final function):
+ * - 6: coef (vector of coefficients)
+ * - 6 + widthOfX: dir (direction)
+ * - 6 + 2 * widthOfX: grad (gradient)
  *
  * Intra-iteration components (updated in transition step):
- * - 3 + 3 * widthOfX: numRows (number of rows already processed in this iteration)
- * - 4 + 3 * widthOfX: gradNew (intermediate value for gradient)
- * - 4 + 4 * widthOfX: X_transp_AX (X^T A X)
- * - 4 + widthOfX * widthOfX + 4 * widthOfX: logLikelihood ( ln(l(c)) )
-// * - 5 + widthOfX * widthOfX + 4 * widthOfX: dTHd (intermediate value for d^T * H * d)
+ * - 6 + 3 * widthOfX: gradNew (intermediate value for gradient)
+ * - 6 + 4 * widthOfX: X_transp_AX (X^T A X, packed upper triangle)
+ * - 6 + 4 * widthOfX + widthOfX * (widthOfX + 1) / 2: bufferedRows (rows not
+ *   yet added to X_transp_AX, see GramBuffer)
+ *
+ * The legacy layout (version 1) was: iteration, widthOfX, coef, dir, grad,
+ * beta, numRows, gradNew, X_transp_AX (dense), logLikelihood. upgrade()
+ * converts such states.
  */
 class LogisticRegressionCG::State {
 public:
     State(AnyValue inArg)
-        : mStorage(inArg.copyIfImmutable()),
-          iteration(&mStorage[0]),
-          widthOfX(&mStorage[1]),
-          coef(TransparentHandle::create(&mStorage[2]),
-               widthOfX),
-          dir(TransparentHandle::create(&mStorage[2 + widthOfX]),
-              widthOfX),
-          grad(TransparentHandle::create(&mStorage[2 + 2 * widthOfX]),
-              widthOfX),
-          beta(&mStorage[2 + 3 * widthOfX]),
-          
-          numRows(&mStorage[3 + 3 * widthOfX]),
-          gradNew(TransparentHandle::create(&mStorage[4 + 3 * widthOfX]),
-                  widthOfX),
-          X_transp_AX(TransparentHandle::create(&mStorage[4 + 4 * widthOfX]),
-              widthOfX, widthOfX),
-          logLikelihood(&mStorage[4 + widthOfX * widthOfX + 4 * widthOfX])
-        { }
+        : mStorage(inArg.copyIfImmutable()) {
+        
+        rebind(static_cast<uint16_t>(mStorage[2]));
+    }
+
+    /**
+     * @brief Bind to a state that is already given as an array
+     *
+     * This constructor does not allocate memory. It is used by the in-place
+     * transition function.
+     */
+    State(const Array<double> &inStorage)
+        : mStorage(inStorage) {
+        
+        rebind(static_cast<uint16_t>(mStorage[2]));
+    }
     
+    /**
+     * @brief Check whether an array is a state for the given number of
+     *        independent variables that has seen at least one row in the
+     *        current iteration
+     */
+    static inline bool isInitialized(const Array<double> &inStorage,
+        const uint32_t inWidthOfX) {
+        
+        return inStorage.size() == arraySize(inWidthOfX)
+            && inStorage[0] == kLayout
+            && inStorage[2] == inWidthOfX
+            && inStorage[4] > 0;
+    }
+    
+    /**
+     * @brief Convert a state in the legacy layout into the current layout
+     *
+     * States in the current layout and uninitialized states are returned
+     * unchanged (without copying).
+     */
+    static AnyValue upgrade(const AnyValue &inState,
+        AllocatorSPtr inAllocator) {
+        
+        Array_const<double> legacy = inState;
+        uint16_t widthOfX = static_cast<uint16_t>(legacy[1]);
+        if (legacy[0] == kLayout || widthOfX == 0
+            || legacy.size()
+                != 5 + 4 * widthOfX
+                    + static_cast<std::size_t>(widthOfX) * widthOfX)
+            return inState;
+        
+        Array<double> storage(inAllocator,
+            boost::extents[ arraySize(widthOfX) ]);
+        storage[0] = kLayout;
+        storage[2] = widthOfX;
+        
+        State state(storage);
+        const double *legacyVectors = legacy.data() + 2;
+        state.iteration = static_cast<uint32_t>(legacy[0]);
+        state.beta = legacy[2 + 3 * widthOfX];
+        state.numRows = static_cast<uint64_t>(legacy[3 + 3 * widthOfX]);
+        state.logLikelihood = legacy[4 + 4 * widthOfX
+            + static_cast<std::size_t>(widthOfX) * widthOfX];
+        for (uint16_t i = 0; i < widthOfX; i++) {
+            state.coef(i) = legacyVectors[i];
+            state.dir(i) = legacyVectors[widthOfX + i];
+            state.grad(i) = legacyVectors[2 * widthOfX + i];
+            state.gradNew(i) = legacyVectors[2 + 3 * widthOfX + i];
+        }
+        packUpperTriangle(widthOfX, legacy.data() + 4 + 4 * widthOfX,
+            state.X_transp_AX.memptr());
+        return state;
+    }
+
     /**
      * We define this function so that we can use State in the
      * argument list and as a return type.
@@ -112,22 +325,14 @@ public:
         const uint16_t inWidthOfX) {
         
         mStorage.rebind(inAllocator, boost::extents[ arraySize(inWidthOfX) ]);
-        iteration.rebind(&mStorage[0]) = 0;
-        widthOfX.rebind(&mStorage[1]) = inWidthOfX;
-        coef.rebind(TransparentHandle::create(&mStorage[2]),
-                    widthOfX).zeros();
-        dir.rebind(TransparentHandle::create(&mStorage[2 + widthOfX]),
-                   widthOfX).zeros();
-        grad.rebind(TransparentHandle::create(&mStorage[2 + 2 * widthOfX]),
-                    widthOfX).zeros();
-        beta.rebind(&mStorage[2 + 3 * widthOfX]) = 0;
-
-        numRows.rebind(&mStorage[3 + 3 * widthOfX]);
-        gradNew.rebind(TransparentHandle::create(&mStorage[4 + 3 * widthOfX]),
-                       widthOfX);
-        X_transp_AX.rebind(TransparentHandle::create(&mStorage[4 + 4 * widthOfX]),
-              widthOfX, widthOfX);
-        logLikelihood.rebind(&mStorage[4 + widthOfX * widthOfX + 4 * widthOfX]);
+        rebind(inWidthOfX);
+        mStorage[0] = kLayout;
+        iteration = 0;
+        widthOfX = inWidthOfX;
+        coef.zeros();
+        dir.zeros();
+        grad.zeros();
+        beta = 0;
         reset();
     }
     
@@ -150,6 +355,7 @@ public:
         numRows += inOtherState.numRows;
         gradNew += inOtherState.gradNew;
         X_transp_AX += inOtherState.X_transp_AX;
+        inOtherState.bufferedRows.addTo(X_transp_AX.memptr());
         logLikelihood += inOtherState.logLikelihood;
         return *this;
     }
@@ -162,11 +368,114 @@ public:
         X_transp_AX.zeros();
         gradNew.zeros();
         logLikelihood = 0;
+        bufferedRows.clear();
+    }
+    
+    /**
+     * @brief Add a row to the intra-iteration fields
+     */
+    inline void update(double inY, const arma::rowvec &inX) {
+        const double *x = inX.memptr();
+        update(1, &inY, &x);
+    }
+    
+    /**
+     * @brief Add a block of rows to the intra-iteration fields
+     *
+     * We first compute all linear predictors and the row-wise scalars (see
+     * logisticTerms()), and then update the gradient and \f$ X^T A X \f$ in a
+     * single pass over the rows.
+     *
+     * @param inNumRows Number of rows (at most kRowBlockSize)
+     * @param inY Dependent variables (-1 or 1)
+     * @param inX Independent variables, one pointer per row
+     *
+     * @internal We deliberately do not use Armadillo expressions like
+     *     <tt>trans(x) * a * x</tt> here because they would create temporaries
+     *     on the heap for every row.
+     */
+    inline void update(uint32_t inNumRows, const double *inY,
+        const double *const *inX) {
+        
+        const double *c = coef.memptr();
+        double *g = gradNew.memptr();
+        uint16_t width = widthOfX;
+        double xc[kRowBlockSize];
+        double a[kRowBlockSize];
+        double gradScale[kRowBlockSize];
+        
+        numRows += inNumRows;
+        
+        for (uint32_t i = 0; i < inNumRows; i++)
+            xc[i] = dot(width, inX[i], c);
+        
+        //          n
+        //         --
+        // l(c) = -\  log(1 + exp(-y_i * c^T x_i))
+        //         /_
+        //         i=1
+        logLikelihood -= logisticTerms(inNumRows, inY, xc, a, gradScale);
+        
+        for (uint32_t i = 0; i < inNumRows; i++) {
+            const double *x = inX[i];
+            
+            for (uint16_t j = 0; j < width; j++)
+                g[j] += gradScale[i] * x[j];
+            
+            // a_i >= 0, so X^T A X is the Gram matrix of the rows sqrt(a_i) x_i
+            if (bufferedRows.isEnabled())
+                bufferedRows.push(x, std::sqrt(a[i]), X_transp_AX.memptr());
+            else
+                symmetricRankOneUpdate(width, a[i], x, X_transp_AX.memptr());
+        }
+    }
+    
+    /**
+     * @brief Return the full matrix \f$ X^T A X \f$, including buffered rows
+     */
+    inline mat gramMatrix() const {
+        uint16_t width = widthOfX;
+        colvec packed = X_transp_AX;
+        bufferedRows.addTo(packed.memptr());
+        
+        mat result(width, width);
+        unpackSymmetric(width, packed.memptr(), result.memptr());
+        return result;
     }
 
 private:
-    static inline uint32_t arraySize(const uint16_t inWidthOfX) {
-        return 5 + inWidthOfX * inWidthOfX + 4 * inWidthOfX;
+    /**
+     * @brief Marker in element 0 of states in the current layout (version 2)
+     *
+     * It is negative so that it cannot be confused with the iteration field
+     * that legacy states have in element 0. (Uninitialized states are all 0.)
+     */
+    static const int kLayout = -2;
+
+    static inline uint32_t arraySize(const uint32_t inWidthOfX) {
+        return 6 + 4 * inWidthOfX + packedSize(inWidthOfX)
+            + GramBuffer::arraySize(inWidthOfX);
+    }
+
+    /**
+     * @brief Rebind all views to the current storage array
+     */
+    inline void rebind(uint16_t inWidthOfX) {
+        iteration.rebind(&mStorage[1]);
+        widthOfX.rebind(&mStorage[2]);
+        beta.rebind(&mStorage[3]);
+        numRows.rebind(&mStorage[4]);
+        logLikelihood.rebind(&mStorage[5]);
+        
+        coef.rebind(mStorage.data() + 6, inWidthOfX);
+        dir.rebind(mStorage.data() + 6 + inWidthOfX, inWidthOfX);
+        grad.rebind(mStorage.data() + 6 + 2 * inWidthOfX, inWidthOfX);
+        gradNew.rebind(mStorage.data() + 6 + 3 * inWidthOfX, inWidthOfX);
+        X_transp_AX.rebind(mStorage.data() + 6 + 4 * inWidthOfX,
+            packedSize(inWidthOfX));
+        bufferedRows.rebind(
+            mStorage.data() + 6 + 4 * inWidthOfX + packedSize(inWidthOfX),
+            inWidthOfX);
     }
 
     Array<double> mStorage;
@@ -181,18 +490,11 @@ public:
     
     Reference<double, uint64_t> numRows;
     DoubleCol gradNew;
-    DoubleMat X_transp_AX;
+    DoubleCol X_transp_AX;
     Reference<double> logLikelihood;
-//    Reference<double> dTHd;
+    GramBuffer bufferedRows;
 };
 
-/**
- * @brief Logistic function
- */
-static double sigma(double x) {
-	return 1. / (1. + std::exp(-x));
-}
-
 /**
  * @brief Perform the logistic-regression transition step
  */
@@ -200,47 +502,74 @@ AnyValue LogisticRegressionCG::transition(AbstractDBInterface &db, AnyValue args
     AnyValue::iterator arg(args);
     
     // Initialize Arguments from SQL call
-    State state = *arg++;
+    State state = State::upgrade(*arg++,
+        db.allocator(AbstractAllocator::kAggregate));
     double y = *arg++ ? 1. : -1.;
     DoubleRow_const x = *arg++;
     if (state.numRows == 0) {
         state.initialize(db.allocator(AbstractAllocator::kAggregate), x.n_elem);
         if (!arg->isNull()) {
-            const State previousState = *arg;
+            const State previousState = State::upgrade(*arg,
+                db.allocator());
             
             state = previousState;
             state.reset();
         }
     }
     
+    if (x.n_elem != state.widthOfX)
+        throw std::invalid_argument("Inconsistent numbers of independent "
+            "variables.");
+    
     // Now do the transition step
-    state.numRows++;
-	
-    double xc = as_scalar( x * state.coef );
-	double xd = as_scalar( x * state.dir );
-    
-    state.gradNew += sigma(-y * xc) * y * trans(x);
-
-    // Note: sigma(-x) = 1 - sigma(x).
-    // a_i = sigma(x_i c) sigma(-x_i c)
-    double a = sigma(xc) * sigma(-xc);
-    state.X_transp_AX += trans(x) * a * x;
-
-    //          n
-    //         --
-    // l(c) = -\  log(1 + exp(-y_i * c^T x_i))
-    //         /_
-    //         i=1
-    state.logLikelihood -= std::log( 1. + std::exp(-y * xc) );
+    state.update(y, x);
     return state;
 }
 
+/**
+ * @brief Perform the logistic-regression transition step without allocating
+ *        memory
+ *
+ * This is the fast path for all but the first row of each iteration: The
+ * state is modified in-place. We return false (and let transition() handle
+ * the call) whenever the state is not yet initialized.
+ */
+bool LogisticRegressionCG::transitionInPlace(const RawArgument *inArgs,
+    uint16_t inNumArgs) {
+    
+    if (!TransitionArgs::accepts(inArgs, inNumArgs))
+        return false;
+    
+    TransitionArgs args(inArgs, inNumArgs);
+    const Array<double> &storage = args.get<0>();
+    double y = args.get<1>() ? 1. : -1.;
+    const DoubleRow_const &x = args.get<2>();
+    
+    if (!State::isInitialized(storage, x.n_elem))
+        return false;
+    
+    State state(storage);
+    state.update(y, x);
+    return true;
+}
+
+/**
+ * @brief Perform the logistic-regression transition step for a block of rows
+ *        from the design-matrix cache
+ */
+AnyValue LogisticRegressionCG::blockTransition(AbstractDBInterface &db,
+    AnyValue args) {
+    
+    return transitionFromBlock<State>(db, args);
+}
+
 /**
  * @brief Perform the perliminary aggregation function: Merge transition states
  */
 AnyValue LogisticRegressionCG::mergeStates(AbstractDBInterface &db, AnyValue args) {
-    State stateLeft = args[0].copyIfImmutable();
-    const State stateRight = args[1];
+    State stateLeft = State::upgrade(args[0],
+        db.allocator(AbstractAllocator::kAggregate)).copyIfImmutable();
+    const State stateRight = State::upgrade(args[1], db.allocator());
 
     // We first handle the trivial case where this function is called with one
     // of the states being the initial state
@@ -254,12 +583,36 @@ AnyValue LogisticRegressionCG::mergeStates(AbstractDBInterface &db, AnyValue arg
     return stateLeft;
 }
 
+/**
+ * @brief Return a state for the first iteration of the conjugate-gradient
+ *        method that starts at the given coefficients
+ *
+ * @see LogisticRegressionIRLS::initialState()
+ */
+AnyValue LogisticRegressionCG::initialState(AbstractDBInterface &db,
+    AnyValue args) {
+    
+    DoubleRow_const coef = args[0];
+    if (!coef.is_finite())
+        throw std::invalid_argument("Initial coefficients are not finite.");
+    
+    // Same as the INITCOND of the aggregate
+    Array<double> storage(db.allocator(), boost::extents[ 6 ]);
+    State state(storage);
+    state.initialize(db.allocator(), coef.n_elem);
+    const double *coefData = static_cast<const arma::rowvec&>(coef).memptr();
+    std::copy(coefData, coefData + coef.n_elem, state.coef.memptr());
+    return state;
+}
+
 /**
  * @brief Perform the logistic-regression final step
  */
 AnyValue LogisticRegressionCG::final(AbstractDBInterface &db, AnyValue args) {
     // Argument from SQL call
-    State state = args[0].copyIfImmutable();
+    State state = State::upgrade(args[0],
+        db.allocator(AbstractAllocator::kAggregate)).copyIfImmutable();
+    state.bufferedRows.flush(state.X_transp_AX.memptr());
     
     // Note: k = state.iteration
     if (state.iteration == 0) {
@@ -308,7 +661,7 @@ AnyValue LogisticRegressionCG::final(AbstractDBInterface &db, AnyValue args) {
     //
     // c_k = c_{k-1} - alpha_k * d_k
     state.coef += dot(state.grad, state.dir) /
-        as_scalar(trans(state.dir) * state.X_transp_AX * state.dir)
+        as_scalar(trans(state.dir) * state.gramMatrix() * state.dir)
         * state.dir;
 
     state.iteration++;
@@ -319,8 +672,8 @@ AnyValue LogisticRegressionCG::final(AbstractDBInterface &db, AnyValue args) {
  * @brief Return the difference in log-likelihood between two states
  */
 AnyValue LogisticRegressionCG::distance(AbstractDBInterface &db, AnyValue args) {
-    const State stateLeft = args[0];
-    const State stateRight = args[1];
+    const State stateLeft = State::upgrade(args[0], db.allocator());
+    const State stateRight = State::upgrade(args[1], db.allocator());
 
     return std::abs(stateLeft.logLikelihood - stateRight.logLikelihood);
 }
@@ -329,13 +682,10 @@ AnyValue LogisticRegressionCG::distance(AbstractDBInterface &db, AnyValue args)
  * @brief Return the coefficients and diagnostic statistics of the state
  */
 AnyValue LogisticRegressionCG::result(AbstractDBInterface &db, AnyValue args) {
-    const State state = args[0];
+    const State state = State::upgrade(args[0], db.allocator());
 
-    // Compute (X^T * A * X)^+
-    mat inverse_of_X_transp_AX = pinv(state.X_transp_AX);
-    
     return stateToResult(db, state.coef, state.logLikelihood,
-        inverse_of_X_transp_AX);
+        SymmetricPositiveDecomposition(state.gramMatrix()));
 }
 
 /**
@@ -350,32 +700,121 @@ AnyValue LogisticRegressionCG::result(AbstractDBInterface &db, AnyValue args) {
  * Note: We assume that the DOUBLE PRECISION array is initialized by the
  * database with length at least 4, and all elemenets are 0.
  *
- * @internal Array layout (iteration refers to one aggregate-function call):
+ * The symmetric matrix \f$ X^T A X \f$ is stored as packed upper triangle (see
+ * packedSymmetric.hpp).
+ *
+ * Besides the statistics for the Newton step at \c coef, the transition step
+ * computes the log-likelihood at the points of a step-halving line search
+ * between \c previousCoef and \c coef (see LogisticRegressionIRLS::final()).
+ *
+ * @internal Array layout, version 2 (iteration refers to one aggregate-function
+ * call):
+ * - 0: layout (always kLayout)
+ *
+ * Inter-iteration components (updated in final function):
+ * - 1: widthOfX (number of coefficients)
+ *
+ * Intra-iteration components (updated in transition step):
+ * - 2: numRows (number of rows already processed in this iteration)
+ * - 3: logLikelihood ( ln(l(c)) )
+ *
  * Inter-iteration components (updated in final function):
- * - 0: widthOfX (number of coefficients)
- * - 1: coef (vector of coefficients)
+ * - 4: lineSearch (whether to evaluate the step-halving candidates)
+ * - 5: previousLogLikelihood (log-likelihood at previousCoef)
  *
  * Intra-iteration components (updated in transition step):
- * - 1 + widthOfX: numRows (number of rows already processed in this iteration)
- * - 2 + widthOfX: X_transp_Az (X^T A z)
- * - 2 + 2 * widthOfX: X_transp_AX (X^T A X)
- * - 2 + widthOfX^2 + 2 * widthOfX: logLikelihood ( ln(l(c)) )
+ * - 6: stepLogLikelihood (log-likelihood at previousCoef
+ *   + 2^-(j+1) (coef - previousCoef) for j = 0, ..., kNumStepHalvings - 1)
+ *
+ * Inter-iteration components (updated in final function):
+ * - 6 + kNumStepHalvings: coef (vector of coefficients)
+ * - 6 + kNumStepHalvings + widthOfX: previousCoef (coefficients of the
+ *   previous Newton step)
+ *
+ * Intra-iteration components (updated in transition step):
+ * - 6 + kNumStepHalvings + 2 * widthOfX: X_transp_Az (X^T A z)
+ * - 6 + kNumStepHalvings + 3 * widthOfX: X_transp_AX (X^T A X, packed upper
+ *   triangle)
+ * - 6 + kNumStepHalvings + 3 * widthOfX + widthOfX * (widthOfX + 1) / 2:
+ *   bufferedRows (rows not yet added to X_transp_AX, see GramBuffer)
+ *
+ * The legacy layout (version 1) was: widthOfX, coef, numRows, X_transp_Az,
+ * X_transp_AX (dense), logLikelihood. upgrade() converts such states.
  */
 class LogisticRegressionIRLS::State {
 public:
+    /**
+     * @brief Number of step sizes 1/2, 1/4, ... evaluated by the line search
+     */
+    enum { kNumStepHalvings = 3 };
+    
     State(AnyValue inArg)
-        : mStorage(inArg.copyIfImmutable()),
-          widthOfX(&mStorage[0]),
-          coef(TransparentHandle::create(&mStorage[1]),
-               widthOfX),
+        : mStorage(inArg.copyIfImmutable()) {
         
-          numRows(&mStorage[1 + widthOfX]),
-          X_transp_Az(TransparentHandle::create(&mStorage[2 + widthOfX]),
-              widthOfX),
-          X_transp_AX(TransparentHandle::create(&mStorage[2 + 2 * widthOfX]),
-              widthOfX, widthOfX),
-          logLikelihood(&mStorage[2 + widthOfX * widthOfX + 2 * widthOfX])
-        { }
+        rebind(static_cast<uint16_t>(mStorage[1]));
+    }
+    
+    /**
+     * @brief Bind to a state that is already given as an array
+     *
+     * This constructor does not allocate memory. It is used by the in-place
+     * transition function.
+     */
+    State(const Array<double> &inStorage)
+        : mStorage(inStorage) {
+        
+        rebind(static_cast<uint16_t>(mStorage[1]));
+    }
+    
+    /**
+     * @brief Check whether an array is a state for the given number of
+     *        independent variables that has seen at least one row in the
+     *        current iteration
+     */
+    static inline bool isInitialized(const Array<double> &inStorage,
+        const uint32_t inWidthOfX) {
+        
+        return inStorage.size() == arraySize(inWidthOfX)
+            && inStorage[0] == kLayout
+            && inStorage[1] == inWidthOfX
+            && inStorage[2] > 0;
+    }
+    
+    /**
+     * @brief Convert a state in the legacy layout into the current layout
+     *
+     * States in the current layout and uninitialized states are returned
+     * unchanged (without copying).
+     */
+    static AnyValue upgrade(const AnyValue &inState,
+        AllocatorSPtr inAllocator) {
+        
+        Array_const<double> legacy = inState;
+        uint16_t widthOfX = legacy[0] > 0
+            ? static_cast<uint16_t>(legacy[0]) : 0;
+        if (widthOfX == 0
+            || legacy.size()
+                != 3 + 2 * widthOfX
+                    + static_cast<std::size_t>(widthOfX) * widthOfX)
+            return inState;
+        
+        Array<double> storage(inAllocator,
+            boost::extents[ arraySize(widthOfX) ]);
+        storage[0] = kLayout;
+        storage[1] = widthOfX;
+        
+        State state(storage);
+        state.numRows = static_cast<uint64_t>(legacy[1 + widthOfX]);
+        state.logLikelihood = legacy[2 + 2 * widthOfX
+            + static_cast<std::size_t>(widthOfX) * widthOfX];
+        for (uint16_t i = 0; i < widthOfX; i++) {
+            state.coef(i) = legacy[1 + i];
+            state.X_transp_Az(i) = legacy[2 + widthOfX + i];
+        }
+        packUpperTriangle(widthOfX, legacy.data() + 2 + 2 * widthOfX,
+            state.X_transp_AX.memptr());
+        return state;
+    }
     
     /**
      * We define this function so that we can use State in the
@@ -394,16 +833,13 @@ public:
         const uint16_t inWidthOfX) {
         
         mStorage.rebind(inAllocator, boost::extents[ arraySize(inWidthOfX) ]);
-        widthOfX.rebind(&mStorage[0]) = inWidthOfX;
-        coef.rebind(TransparentHandle::create(&mStorage[1]),
-                    widthOfX).zeros();
-        
-        numRows.rebind(&mStorage[1 + widthOfX]);
-        X_transp_Az.rebind(TransparentHandle::create(&mStorage[2 + widthOfX]),
-                           widthOfX);
-        X_transp_AX.rebind(TransparentHandle::create(&mStorage[2 + 2 * widthOfX]),
-                           widthOfX, widthOfX);
-        logLikelihood.rebind(&mStorage[2 + widthOfX * widthOfX + 2 * widthOfX]);
+        rebind(inWidthOfX);
+        mStorage[0] = kLayout;
+        widthOfX = inWidthOfX;
+        lineSearch = false;
+        previousLogLikelihood = 0;
+        coef.zeros();
+        previousCoef.zeros();
         reset();
     }
     
@@ -426,7 +862,9 @@ public:
         numRows += inOtherState.numRows;
         X_transp_Az += inOtherState.X_transp_Az;
         X_transp_AX += inOtherState.X_transp_AX;
+        inOtherState.bufferedRows.addTo(X_transp_AX.memptr());
         logLikelihood += inOtherState.logLikelihood;
+        stepLogLikelihood += inOtherState.stepLogLikelihood;
         return *this;
     }
     
@@ -438,23 +876,164 @@ public:
         X_transp_Az.zeros();
         X_transp_AX.zeros();
         logLikelihood = 0;
+        stepLogLikelihood.zeros();
+        bufferedRows.clear();
+    }
+    
+    /**
+     * @brief Add a row to the intra-iteration fields
+     */
+    inline void update(double inY, const arma::rowvec &inX) {
+        const double *x = inX.memptr();
+        update(1, &inY, &x);
+    }
+    
+    /**
+     * @brief Add a block of rows to the intra-iteration fields
+     *
+     * We first compute all linear predictors and the row-wise scalars (see
+     * logisticTerms()), and then update \f$ X^T A z \f$ and \f$ X^T A X \f$ in
+     * a single pass over the rows.
+     *
+     * @param inNumRows Number of rows (at most kRowBlockSize)
+     * @param inY Dependent variables (-1 or 1)
+     * @param inX Independent variables, one pointer per row
+     *
+     * @internal We deliberately do not use Armadillo expressions like
+     *     <tt>trans(x) * a * x</tt> here because they would create temporaries
+     *     on the heap for every row.
+     */
+    inline void update(uint32_t inNumRows, const double *inY,
+        const double *const *inX) {
+        
+        const double *c = coef.memptr();
+        double *xTAz = X_transp_Az.memptr();
+        uint16_t width = widthOfX;
+        double xc[kRowBlockSize];
+        double a[kRowBlockSize];
+        double gradScale[kRowBlockSize];
+        
+        numRows += inNumRows;
+        
+        // xc = x_i c
+        for (uint32_t i = 0; i < inNumRows; i++)
+            xc[i] = dot(width, inX[i], c);
+        
+        //          n
+        //         --
+        // l(c) = -\  ln(1 + exp(-y_i * c^T x_i))
+        //         /_
+        //         i=1
+        logLikelihood -= logisticTerms(inNumRows, inY, xc, a, gradScale);
+        
+        // Line search: With p = previousCoef, the linear predictor at
+        // p + t (c - p) is (1 - t) x_i p + t x_i c.
+        if (lineSearch) {
+            const double *p = previousCoef.memptr();
+            double xp[kRowBlockSize];
+            
+            for (uint32_t i = 0; i < inNumRows; i++)
+                xp[i] = dot(width, inX[i], p);
+            
+            double t = 1.;
+            for (uint16_t j = 0; j < kNumStepHalvings; j++) {
+                t /= 2.;
+                for (uint32_t i = 0; i < inNumRows; i++)
+                    stepLogLikelihood(j) -= logLikelihoodTerm(
+                        inY[i] * ((1. - t) * xp[i] + t * xc[i]));
+            }
+        }
+        
+        for (uint32_t i = 0; i < inNumRows; i++) {
+            const double *x = inX[i];
+            
+            //             sigma(-y_i x_i c) y_i
+            // z = x_i c + ---------------------
+            //                     a_i
+            //
+            // We add x_i a_i z to X^T A z.
+            double az = a[i] * xc[i] + gradScale[i];
+            for (uint16_t j = 0; j < width; j++)
+                xTAz[j] += x[j] * az;
+            
+            // a_i >= 0, so X^T A X is the Gram matrix of the rows sqrt(a_i) x_i
+            if (bufferedRows.isEnabled())
+                bufferedRows.push(x, std::sqrt(a[i]), X_transp_AX.memptr());
+            else
+                symmetricRankOneUpdate(width, a[i], x, X_transp_AX.memptr());
+        }
+    }
+    
+    /**
+     * @brief Return the full matrix \f$ X^T A X \f$, including buffered rows
+     */
+    inline mat gramMatrix() const {
+        uint16_t width = widthOfX;
+        colvec packed = X_transp_AX;
+        bufferedRows.addTo(packed.memptr());
+        
+        mat result(width, width);
+        unpackSymmetric(width, packed.memptr(), result.memptr());
+        return result;
     }
     
 private:
-    static inline uint32_t arraySize(const uint16_t inWidthOfX) {
-        return 3 + inWidthOfX * inWidthOfX + 2 * inWidthOfX;
+    /**
+     * @brief Marker in element 0 of states in the current layout (version 2)
+     *
+     * It is negative so that it cannot be confused with the widthOfX field
+     * that legacy states have in element 0. (Uninitialized states are all 0.)
+     */
+    static const int kLayout = -2;
+
+    static inline uint32_t arraySize(const uint32_t inWidthOfX) {
+        return 6 + kNumStepHalvings + 4 * inWidthOfX + packedSize(inWidthOfX)
+            + GramBuffer::arraySize(inWidthOfX);
+    }
+
+    /**
+     * @brief Rebind all views to the current storage array
+     */
+    inline void rebind(uint16_t inWidthOfX) {
+        const std::size_t vectors = 6 + kNumStepHalvings;
+        
+        widthOfX.rebind(&mStorage[1]);
+        numRows.rebind(&mStorage[2]);
+        logLikelihood.rebind(&mStorage[3]);
+        // The initial state from the database has only 4 elements, so we must
+        // not use operator[] (which may check bounds) beyond that.
+        lineSearch.rebind(mStorage.data() + 4);
+        previousLogLikelihood.rebind(mStorage.data() + 5);
+        stepLogLikelihood.rebind(mStorage.data() + 6, kNumStepHalvings);
+        
+        coef.rebind(mStorage.data() + vectors, inWidthOfX);
+        previousCoef.rebind(mStorage.data() + vectors + inWidthOfX,
+            inWidthOfX);
+        X_transp_Az.rebind(mStorage.data() + vectors + 2 * inWidthOfX,
+            inWidthOfX);
+        X_transp_AX.rebind(mStorage.data() + vectors + 3 * inWidthOfX,
+            packedSize(inWidthOfX));
+        bufferedRows.rebind(
+            mStorage.data() + vectors + 3 * inWidthOfX
+                + packedSize(inWidthOfX),
+            inWidthOfX);
     }
 
     Array<double> mStorage;
 
 public:
     Reference<double, uint16_t> widthOfX;
+    Reference<double, bool> lineSearch;
+    Reference<double> previousLogLikelihood;
     DoubleCol coef;
+    DoubleCol previousCoef;
 
     Reference<double, uint64_t> numRows;
     DoubleCol X_transp_Az;
-    DoubleMat X_transp_AX;
+    DoubleCol X_transp_AX;
     Reference<double> logLikelihood;
+    DoubleCol stepLogLikelihood;
+    GramBuffer bufferedRows;
 };
 
 AnyValue LogisticRegressionIRLS::transition(AbstractDBInterface &db,
@@ -462,12 +1041,13 @@ AnyValue LogisticRegressionIRLS::transition(AbstractDBInterface &db,
     AnyValue::iterator arg(args);
     
     // Initialize Arguments from SQL call
-    State state = *arg++;
+    State state = State::upgrade(*arg++,
+        db.allocator(AbstractAllocator::kAggregate));
     double y = *arg++ ? 1. : -1.;
     DoubleRow_const x = *arg++;
 
     // See MADLIB-138. At least on certain platforms and with certain versions,
-    // LAPACK will run into an infinite loop if pinv() is called for non-finite
+    // LAPACK will run into an infinite loop if it is called for non-finite
     // matrices. We extend the check also to the dependent variables.
     if (!boost::math::isfinite(y))
         throw std::invalid_argument("Dependent variables are not finite.");
@@ -477,48 +1057,69 @@ AnyValue LogisticRegressionIRLS::transition(AbstractDBInterface &db,
     if (state.numRows == 0) {
         state.initialize(db.allocator(AbstractAllocator::kAggregate), x.n_elem);
         if (!arg->isNull()) {
-            const State previousState = *arg;
+            const State previousState = State::upgrade(*arg,
+                db.allocator());
             
             state = previousState;
             state.reset();
         }
     }
     
+    if (x.n_elem != state.widthOfX)
+        throw std::invalid_argument("Inconsistent numbers of independent "
+            "variables.");
+    
     // Now do the transition step
-    state.numRows++;
+    state.update(y, x);
+    return state;
+}
 
-    // xc = x_i c
-    double xc = as_scalar( x * state.coef );
-        
-    // a_i = sigma(x_i c) sigma(-x_i c)
-    double a = sigma(xc) * sigma(-xc);
+/**
+ * @brief Perform the logistic-regression transition step without allocating
+ *        memory
+ *
+ * @see LogisticRegressionCG::transitionInPlace()
+ */
+bool LogisticRegressionIRLS::transitionInPlace(const RawArgument *inArgs,
+    uint16_t inNumArgs) {
     
-    // Note: sigma(-x) = 1 - sigma(x).
-    //
-    //             sigma(-y_i x_i c) y_i
-    // z = x_i c + ---------------------
-    //                     a_i
-    double z = xc + sigma(-y * xc) * y / a;
-
-    state.X_transp_Az += trans(x) * a * z;
-    state.X_transp_AX += trans(x) * a * x;
-        
-    // We use state.sumy to store the log likelihood.
-    //          n
-    //         --
-    // l(c) = -\  ln(1 + exp(-y_i * c^T x_i))
-    //         /_
-    //         i=1
-    state.logLikelihood -= std::log( 1. + std::exp(-y * xc) );
-    return state;
+    if (!TransitionArgs::accepts(inArgs, inNumArgs))
+        return false;
+    
+    TransitionArgs args(inArgs, inNumArgs);
+    const Array<double> &storage = args.get<0>();
+    double y = args.get<1>() ? 1. : -1.;
+    const DoubleRow_const &x = args.get<2>();
+    
+    if (!State::isInitialized(storage, x.n_elem))
+        return false;
+    
+    // See MADLIB-138 and transition()
+    if (!x.is_finite())
+        throw std::invalid_argument("Design matrix is not finite.");
+    
+    State state(storage);
+    state.update(y, x);
+    return true;
+}
+
+/**
+ * @brief Perform the logistic-regression transition step for a block of rows
+ *        from the design-matrix cache
+ */
+AnyValue LogisticRegressionIRLS::blockTransition(AbstractDBInterface &db,
+    AnyValue args) {
+    
+    return transitionFromBlock<State>(db, args);
 }
 
 /**
  * @brief Perform the perliminary aggregation function: Merge transition states
  */
 AnyValue LogisticRegressionIRLS::mergeStates(AbstractDBInterface &db, AnyValue args) {
-    State stateLeft = args[0].copyIfImmutable();
-    const State stateRight = args[1];
+    State stateLeft = State::upgrade(args[0],
+        db.allocator(AbstractAllocator::kAggregate)).copyIfImmutable();
+    const State stateRight = State::upgrade(args[1], db.allocator());
     
     // We first handle the trivial case where this function is called with one
     // of the states being the initial state
@@ -532,45 +1133,582 @@ AnyValue LogisticRegressionIRLS::mergeStates(AbstractDBInterface &db, AnyValue a
     return stateLeft;
 }
 
+/**
+ * @brief Return a state for the first iteration of the IRLS method that starts
+ *        at the given coefficients
+ *
+ * This is used to warm-start a refit, e.g., with the coefficients of a
+ * previous fit on similar data. The argument is the coefficient vector.
+ */
+AnyValue LogisticRegressionIRLS::initialState(AbstractDBInterface &db,
+    AnyValue args) {
+    
+    DoubleRow_const coef = args[0];
+    if (!coef.is_finite())
+        throw std::invalid_argument("Initial coefficients are not finite.");
+    
+    // Same as the INITCOND of the aggregate
+    Array<double> storage(db.allocator(), boost::extents[ 4 ]);
+    State state(storage);
+    state.initialize(db.allocator(), coef.n_elem);
+    const double *coefData = static_cast<const arma::rowvec&>(coef).memptr();
+    std::copy(coefData, coefData + coef.n_elem, state.coef.memptr());
+    return state;
+}
+
 /**
  * @brief Perform the logistic-regression final step
+ *
+ * Normally, this is a full Newton step: With \f$ A \f$ and \f$ z \f$
+ * evaluated at the current coefficients \f$ c \f$, the new coefficients are
+ * \f$ (X^T A X)^{-1} X^T A z \f$.
+ *
+ * A full Newton step may overshoot, in particular far from the optimum (e.g.,
+ * for a poor warm start). Therefore, the transition step also computes the
+ * log-likelihood at \f$ p + t (c - p) \f$, where \f$ p \f$ are the
+ * coefficients before the last Newton step and \f$ t = 1/2, 1/4, \dots \f$
+ * (see State::kNumStepHalvings). If the last Newton step decreased the
+ * log-likelihood and one of these points is better than \f$ c \f$, we move
+ * to the best of them instead. We do not have the statistics for a Newton step
+ * at that point, so the next iteration only computes them. Step halving
+ * therefore costs one extra scan when it is needed, and none otherwise. (The
+ * driver also adds this scan when the last iteration ends at such a point, see
+ * result().)
  */
 AnyValue LogisticRegressionIRLS::final(AbstractDBInterface &db, AnyValue args) {
     // Argument from SQL call
-    State state = args[0].copyIfImmutable();
+    State state = State::upgrade(args[0],
+        db.allocator(AbstractAllocator::kAggregate)).copyIfImmutable();
+    state.bufferedRows.flush(state.X_transp_AX.memptr());
 
     // See MADLIB-138. At least on certain platforms and with certain versions,
-    // LAPACK will run into an infinite loop if pinv() is called for non-finite
+    // LAPACK will run into an infinite loop if it is called for non-finite
     // matrices. We extend the check also to the dependent variables.
     if (!state.X_transp_AX.is_finite() || !state.X_transp_Az.is_finite())
         throw std::invalid_argument("Design matrix is not finite.");
     
-    state.coef = pinv(state.X_transp_AX) * state.X_transp_Az;
+    if (state.lineSearch
+        && state.logLikelihood < state.previousLogLikelihood) {
+        
+        uint16_t best = 0;
+        for (uint16_t j = 1; j < State::kNumStepHalvings; j++)
+            if (state.stepLogLikelihood(j) > state.stepLogLikelihood(best))
+                best = j;
+        
+        if (state.stepLogLikelihood(best) > state.logLikelihood) {
+            // c <- p + 2^-(best + 1) (c - p)
+            state.coef -= state.previousCoef;
+            state.coef *= std::ldexp(1., -(best + 1));
+            state.coef += state.previousCoef;
+            state.logLikelihood = state.stepLogLikelihood(best);
+            state.lineSearch = false;
+            return state;
+        }
+    }
+    
+    state.previousCoef = state.coef;
+    state.previousLogLikelihood = state.logLikelihood;
+    state.lineSearch = true;
+    state.coef = SymmetricPositiveDecomposition(state.gramMatrix())
+        .solve(state.X_transp_Az);
     
     return state;
 }
 
 /**
  * @brief Return the difference in log-likelihood between two states
+ *
+ * After final() moved to a step-halving point, the next iteration only
+ * re-evaluates the log-likelihood at that point. The (zero) difference must
+ * not be mistaken for convergence, so we return infinity in that case. Only
+ * such states have lineSearch unset, so the driver also uses the distance of a
+ * state to itself to find out whether it needs one more iteration before
+ * calling result().
  */
 AnyValue LogisticRegressionIRLS::distance(AbstractDBInterface &db, AnyValue args) {
-    const State stateLeft = args[0];
-    const State stateRight = args[1];
+    const State stateLeft = State::upgrade(args[0], db.allocator());
+    const State stateRight = State::upgrade(args[1], db.allocator());
+
+    if (!stateLeft.lineSearch || !stateRight.lineSearch)
+        return std::numeric_limits<double>::infinity();
 
     return std::abs(stateLeft.logLikelihood - stateRight.logLikelihood);
 }
 
 /**
  * @brief Return the coefficients and diagnostic statistics of the state
+ *
+ * The standard errors are computed from the \f$ X^T A X \f$ of the last
+ * iteration. If final() moved to a step-halving point in that iteration, this
+ * matrix belongs to the rejected Newton step. The driver therefore runs one
+ * more iteration in that case (see distance()), and we refuse such states here.
  */
 AnyValue LogisticRegressionIRLS::result(AbstractDBInterface &db, AnyValue args) {
-    const State state = args[0];
+    const State state = State::upgrade(args[0], db.allocator());
+
+    if (!state.lineSearch)
+        throw std::logic_error("Internal error: No Hessian at the current "
+            "coefficients of the IRLS state");
 
-    // Compute (X^T * A * X)^+
-    mat inverse_of_X_transp_AX = pinv(state.X_transp_AX);
-    
     return stateToResult(db, state.coef, state.logLikelihood,
-        inverse_of_X_transp_AX);
+        SymmetricPositiveDecomposition(state.gramMatrix()));
+}
+
+/**
+ * @brief Inter- and intra-iteration state for incremental gradient descent
+ *        for logistic regression
+ *
+ * Each iteration is one pass of (mini-batch) stochastic gradient ascent over
+ * the log-likelihood, starting from the coefficients of the previous
+ * iteration. On Greenplum, every segment runs its own pass over its part of
+ * the data, and the merge function averages the resulting models, weighted by
+ * the number of rows (model averaging). Unlike for CG and IRLS, the size of
+ * the state is linear in the number of independent variables.
+ *
+ * Note: We assume that the DOUBLE PRECISION array is initialized by the
+ * database with length at least 9, and all elemenets are 0.
+ *
+ * @internal Array layout, version 1 (iteration refers to one aggregate-function
+ * call):
+ * - 0: layout (always kLayout)
+ *
+ * Inter-iteration components (updated in final function):
+ * - 1: widthOfX (number of coefficients)
+ * - 2: iteration (current iteration)
+ *
+ * Intra-iteration components (updated in transition step):
+ * - 3: stepSize (step size in this iteration)
+ * - 4: lambda (coefficient of the L2 regularization)
+ * - 5: batchSize (number of rows per gradient step)
+ * - 6: numRows (number of rows already processed in this iteration)
+ * - 7: numBatchRows (number of rows in batchGradient)
+ * - 8: logLikelihood (sum of the log-likelihood of each row at the model
+ *   before the row was processed)
+ *
+ * Inter-iteration components (updated in final function):
+ * - 9: coef (vector of coefficients)
+ *
+ * Intra-iteration components (updated in transition step):
+ * - 9 + widthOfX: incrModel (coefficients updated by each gradient step)
+ * - 9 + 2 * widthOfX: batchGradient (gradient of the rows of the current
+ *   mini-batch)
+ */
+class LogisticRegressionIGD::State {
+public:
+    State(AnyValue inArg)
+        : mStorage(inArg.copyIfImmutable()) {
+        
+        rebind(static_cast<uint16_t>(mStorage[1]));
+    }
+
+    /**
+     * @brief Bind to a state that is already given as an array
+     *
+     * This constructor does not allocate memory. It is used by the in-place
+     * transition function.
+     */
+    State(const Array<double> &inStorage)
+        : mStorage(inStorage) {
+        
+        rebind(static_cast<uint16_t>(mStorage[1]));
+    }
+    
+    /**
+     * @brief Check whether an array is a state for the given number of
+     *        independent variables that has seen at least one row in the
+     *        current iteration
+     */
+    static inline bool isInitialized(const Array<double> &inStorage,
+        const uint32_t inWidthOfX) {
+        
+        return inStorage.size() == arraySize(inWidthOfX)
+            && inStorage[0] == kLayout
+            && inStorage[1] == inWidthOfX
+            && inStorage[6] > 0;
+    }
+
+    /**
+     * @brief Check that an array is a state in the current layout or an
+     *        uninitialized state (all 0, as given by the INITCOND)
+     *
+     * The constructors trust the widthOfX field, so a malformed array (or the
+     * state of a different optimizer, e.g., passed as previous state) would
+     * otherwise lead to reads and writes out of bounds.
+     */
+    static const AnyValue &validate(const AnyValue &inState) {
+        Array_const<double> storage = inState;
+        
+        if (storage.size() == kInitialSize) {
+            bool allZero = true;
+            for (std::size_t i = 0; allZero && i < kInitialSize; i++)
+                allZero = (storage[i] == 0);
+            if (allZero)
+                return inState;
+        }
+        if (storage.size() < kInitialSize || storage[0] != kLayout
+            || storage[1] < 0 || storage[1] > 65535
+            || storage.size() != arraySize(static_cast<uint16_t>(storage[1])))
+            throw std::invalid_argument("Invalid transition state.");
+        return inState;
+    }
+
+    /**
+     * We define this function so that we can use State in the
+     * argument list and as a return type.
+     */
+    inline operator AnyValue() const {
+        return mStorage;
+    }
+    
+    /**
+     * @brief Initialize the incremental-gradient-descent state.
+     * 
+     * This function is only called for the first iteration, for the first row.
+     */
+    inline void initialize(AllocatorSPtr inAllocator,
+        const uint16_t inWidthOfX) {
+        
+        mStorage.rebind(inAllocator, boost::extents[ arraySize(inWidthOfX) ]);
+        rebind(inWidthOfX);
+        mStorage[0] = kLayout;
+        widthOfX = inWidthOfX;
+        iteration = 0;
+        coef.zeros();
+        reset();
+    }
+    
+    /**
+     * @brief We need to support assigning the previous state
+     */
+    State &operator=(const State &inOtherState) {
+        mStorage = inOtherState.mStorage;
+        return *this;
+    }
+    
+    /**
+     * @brief Merge with another State object by averaging the models
+     *
+     * The models are weighted by the number of rows. Rows that have not yet
+     * formed a complete mini-batch are combined into one mini-batch, which is
+     * applied by the final function.
+     */
+    State &operator+=(const State &inOtherState) {
+        if (mStorage.size() != inOtherState.mStorage.size() ||
+            widthOfX != inOtherState.widthOfX)
+            throw std::logic_error("Internal error: Incompatible transition states");
+        
+        double totalNumRows = static_cast<double>(numRows)
+            + static_cast<double>(inOtherState.numRows);
+        incrModel *= static_cast<double>(numRows) / totalNumRows;
+        incrModel += static_cast<double>(inOtherState.numRows) / totalNumRows
+            * inOtherState.incrModel;
+        batchGradient += inOtherState.batchGradient;
+        numRows += inOtherState.numRows;
+        numBatchRows += inOtherState.numBatchRows;
+        logLikelihood += inOtherState.logLikelihood;
+        return *this;
+    }
+    
+    /**
+     * @brief Reset the intra-iteration fields.
+     */
+    inline void reset() {
+        numRows = 0;
+        numBatchRows = 0;
+        logLikelihood = 0;
+        incrModel = coef;
+        batchGradient.zeros();
+    }
+    
+    /**
+     * @brief Process a row
+     *
+     * The gradient of the log-likelihood of row \f$ i \f$ is
+     * \f$ \sigma(-y_i x_i c) y_i x_i \f$. Once a mini-batch is complete, we
+     * move in the direction of its average gradient (minus the gradient of the
+     * regularization term). For mini-batches of size 1, we do that directly,
+     * without accumulating the gradient first.
+     */
+    inline void update(double inY, const arma::rowvec &inX) {
+        const double *x = inX.memptr();
+        double *c = incrModel.memptr();
+        uint16_t width = widthOfX;
+        double xc = dot(width, x, c);
+        double a;
+        double gradScale;
+        
+        numRows++;
+        logLikelihood -= logisticTerms(1, &inY, &xc, &a, &gradScale);
+        
+        if (batchSize <= 1) {
+            double shrink = 1. - stepSize * lambda;
+            double scale = stepSize * gradScale;
+            
+            for (uint16_t j = 0; j < width; j++)
+                c[j] = shrink * c[j] + scale * x[j];
+        } else {
+            double *g = batchGradient.memptr();
+            
+            for (uint16_t j = 0; j < width; j++)
+                g[j] += gradScale * x[j];
+            if (++numBatchRows >= batchSize)
+                applyBatch();
+        }
+    }
+    
+    /**
+     * @brief Perform the gradient step for the rows in batchGradient
+     */
+    inline void applyBatch() {
+        if (numBatchRows == 0)
+            return;
+        
+        double *c = incrModel.memptr();
+        double *g = batchGradient.memptr();
+        uint16_t width = widthOfX;
+        double shrink = 1. - stepSize * lambda;
+        double scale = stepSize / static_cast<double>(numBatchRows);
+        
+        for (uint16_t j = 0; j < width; j++) {
+            c[j] = shrink * c[j] + scale * g[j];
+            g[j] = 0;
+        }
+        numBatchRows = 0;
+    }
+
+private:
+    /**
+     * @brief Marker in element 0 of states in the current layout (version 1)
+     */
+    static const int kLayout = -1;
+
+    /**
+     * @brief Size of the uninitialized state (the INITCOND of the aggregate)
+     */
+    static const std::size_t kInitialSize = 9;
+
+    static inline uint32_t arraySize(const uint32_t inWidthOfX) {
+        return kInitialSize + 3 * inWidthOfX;
+    }
+
+    /**
+     * @brief Rebind all views to the current storage array
+     */
+    inline void rebind(uint16_t inWidthOfX) {
+        widthOfX.rebind(&mStorage[1]);
+        iteration.rebind(&mStorage[2]);
+        stepSize.rebind(&mStorage[3]);
+        lambda.rebind(&mStorage[4]);
+        batchSize.rebind(&mStorage[5]);
+        numRows.rebind(&mStorage[6]);
+        numBatchRows.rebind(&mStorage[7]);
+        logLikelihood.rebind(&mStorage[8]);
+        
+        coef.rebind(mStorage.data() + 9, inWidthOfX);
+        incrModel.rebind(mStorage.data() + 9 + inWidthOfX, inWidthOfX);
+        batchGradient.rebind(mStorage.data() + 9 + 2 * inWidthOfX,
+            inWidthOfX);
+    }
+
+    Array<double> mStorage;
+
+public:
+    Reference<double, uint16_t> widthOfX;
+    Reference<double, uint32_t> iteration;
+    DoubleCol coef;
+    
+    Reference<double> stepSize;
+    Reference<double> lambda;
+    Reference<double, uint32_t> batchSize;
+    Reference<double, uint64_t> numRows;
+    Reference<double, uint32_t> numBatchRows;
+    Reference<double> logLikelihood;
+    DoubleCol incrModel;
+    DoubleCol batchGradient;
+};
+
+/**
+ * @brief Perform the logistic-regression transition step
+ *
+ * The arguments are the state, the dependent and independent variables, the
+ * previous state, and the parameters: initial step size, step-size decay
+ * (the step size in iteration \f$ k \f$ is
+ * \f$ \mathit{stepSize} \cdot \mathit{stepDecay}^k \f$), mini-batch size, and
+ * regularization coefficient. The parameters are stored in the state when the
+ * first row of an iteration is processed.
+ */
+AnyValue LogisticRegressionIGD::transition(AbstractDBInterface &db, AnyValue args) {
+    AnyValue::iterator arg(args);
+    
+    // Initialize Arguments from SQL call
+    State state = State::validate(*arg++);
+    double y = *arg++ ? 1. : -1.;
+    DoubleRow_const x = *arg++;
+    
+    if (!x.is_finite())
+        throw std::invalid_argument("Design matrix is not finite.");
+    
+    if (state.numRows == 0) {
+        state.initialize(db.allocator(AbstractAllocator::kAggregate), x.n_elem);
+        if (!arg->isNull()) {
+            const State previousState = State::validate(*arg);
+            
+            state = previousState;
+            state.reset();
+        }
+        arg++;
+        
+        double stepSize = *arg++;
+        double stepDecay = *arg++;
+        int32_t batchSize = *arg++;
+        double lambda = *arg++;
+        if (!(stepSize > 0) || !(stepDecay > 0) || batchSize < 1
+            || !(lambda >= 0))
+            throw std::invalid_argument("Step size and step-size decay must "
+                "be positive, the mini-batch size must be at least 1, and "
+                "the regularization coefficient must not be negative.");
+        
+        state.stepSize = stepSize
+            * std::pow(stepDecay, static_cast<double>(state.iteration));
+        state.batchSize = batchSize;
+        state.lambda = lambda;
+    }
+    
+    if (x.n_elem != state.widthOfX)
+        throw std::invalid_argument("Inconsistent numbers of independent "
+            "variables.");
+    
+    // Now do the transition step
+    state.update(y, x);
+    return state;
+}
+
+/**
+ * @brief Perform the logistic-regression transition step without allocating
+ *        memory
+ *
+ * @see LogisticRegressionCG::transitionInPlace()
+ */
+bool LogisticRegressionIGD::transitionInPlace(const RawArgument *inArgs,
+    uint16_t inNumArgs) {
+    
+    if (!TransitionArgs::accepts(inArgs, inNumArgs))
+        return false;
+    
+    TransitionArgs args(inArgs, inNumArgs);
+    const Array<double> &storage = args.get<0>();
+    double y = args.get<1>() ? 1. : -1.;
+    const DoubleRow_const &x = args.get<2>();
+    
+    if (!State::isInitialized(storage, x.n_elem))
+        return false;
+    
+    if (!x.is_finite())
+        throw std::invalid_argument("Design matrix is not finite.");
+    
+    State state(storage);
+    state.update(y, x);
+    return true;
+}
+
+/**
+ * @brief Perform the perliminary aggregation function: Merge transition states
+ */
+AnyValue LogisticRegressionIGD::mergeStates(AbstractDBInterface &db, AnyValue args) {
+    State stateLeft = State::validate(args[0]);
+    const State stateRight = State::validate(args[1]);
+    
+    // We first handle the trivial case where this function is called with one
+    // of the states being the initial state
+    if (stateLeft.numRows == 0)
+        return stateRight;
+    else if (stateRight.numRows == 0)
+        return stateLeft;
+    
+    // Merge states together and return
+    stateLeft += stateRight;
+    return stateLeft;
+}
+
+/**
+ * @brief Return a state for the first iteration of incremental gradient
+ *        descent that starts at the given coefficients
+ *
+ * @see LogisticRegressionIRLS::initialState()
+ */
+AnyValue LogisticRegressionIGD::initialState(AbstractDBInterface &db,
+    AnyValue args) {
+    
+    DoubleRow_const coef = args[0];
+    if (!coef.is_finite())
+        throw std::invalid_argument("Initial coefficients are not finite.");
+    
+    // Same as the INITCOND of the aggregate
+    Array<double> storage(db.allocator(), boost::extents[ 9 ]);
+    State state(storage);
+    state.initialize(db.allocator(), coef.n_elem);
+    const double *coefData = static_cast<const arma::rowvec&>(coef).memptr();
+    std::copy(coefData, coefData + coef.n_elem, state.coef.memptr());
+    return state;
+}
+
+/**
+ * @brief Perform the logistic-regression final step
+ *
+ * We apply the last (incomplete) mini-batch and make the resulting model the
+ * starting point of the next iteration.
+ */
+AnyValue LogisticRegressionIGD::final(AbstractDBInterface &db, AnyValue args) {
+    // Argument from SQL call
+    State state = State::validate(args[0]);
+    
+    state.applyBatch();
+    if (!state.incrModel.is_finite())
+        throw std::invalid_argument("Coefficients are not finite. The step "
+            "size might be too large.");
+    
+    state.coef = state.incrModel;
+    state.iteration++;
+    return state;
+}
+
+/**
+ * @brief Return the difference in log-likelihood between two states
+ *
+ * The log-likelihood of an iteration is accumulated while the model changes,
+ * so the difference is only an estimate of the progress.
+ */
+AnyValue LogisticRegressionIGD::distance(AbstractDBInterface &db, AnyValue args) {
+    const State stateLeft = State::validate(args[0]);
+    const State stateRight = State::validate(args[1]);
+
+    return std::abs(stateLeft.logLikelihood - stateRight.logLikelihood);
+}
+
+/**
+ * @brief Return the coefficients and the log-likelihood of the state
+ *
+ * Standard errors, Wald statistics, and p-values would require the Hessian,
+ * which incremental gradient descent does not compute. They are NULL.
+ */
+AnyValue LogisticRegressionIGD::result(AbstractDBInterface &db, AnyValue args) {
+    const State state = State::validate(args[0]);
+    
+    DoubleCol oddRatios(db.allocator(), state.coef.n_elem);
+    for (unsigned int i = 0; i < state.coef.n_elem; i++)
+        oddRatios(i) = std::exp( state.coef(i) );
+    
+    AnyValueVector tuple;
+    ConcreteRecord::iterator tupleElement(tuple);
+    
+    tupleElement++ = state.coef;
+    tupleElement++ = static_cast<double>(state.logLikelihood);
+    tupleElement++ = Null();
+    tupleElement++ = Null();
+    tupleElement++ = Null();
+    tupleElement++ = oddRatios;
+    
+    return tuple;
 }
 
 /**
@@ -582,14 +1720,16 @@ AnyValue LogisticRegressionIRLS::result(AbstractDBInterface &db, AnyValue args)
 AnyValue stateToResult(AbstractDBInterface &db,
     const DoubleCol &inCoef,
     const double &inLogLikelihood,
-    const mat &inInverse_of_X_transp_AX) {
+    const SymmetricPositiveDecomposition &inX_transp_AX) {
     
+    // We only need the diagonal of (X^T * A * X)^+
+    colvec diagonal_of_inverse = inX_transp_AX.pseudoInverseDiagonal();
     DoubleCol stdErr(db.allocator(), inCoef.n_elem);
     DoubleCol waldZStats(db.allocator(), inCoef.n_elem);
     DoubleCol waldPValues(db.allocator(), inCoef.n_elem);
     DoubleCol oddRatios(db.allocator(), inCoef.n_elem);
     for (unsigned int i = 0; i < inCoef.n_elem; i++) {
-        stdErr(i) = std::sqrt(inInverse_of_X_transp_AX(i,i));
+        stdErr(i) = std::sqrt(diagonal_of_inverse(i));
         waldZStats(i) = inCoef(i) / stdErr(i);
         waldPValues(i) = 2. *  ( boost::math::cdf(boost::math::normal(),
             -std::abs( waldZStats(i) )) );
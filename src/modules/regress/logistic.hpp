@@ -20,9 +20,14 @@ namespace regress {
  */
 struct LogisticRegressionCG {
     class State;
+    typedef Args<Array<double>, bool, DoubleRow_const> TransitionArgs;
     
     static AnyValue transition(AbstractDBInterface &db, AnyValue args);
+    static bool transitionInPlace(const RawArgument *inArgs,
+        uint16_t inNumArgs);
+    static AnyValue blockTransition(AbstractDBInterface &db, AnyValue args);
     static AnyValue mergeStates(AbstractDBInterface &db, AnyValue args);
+    static AnyValue initialState(AbstractDBInterface &db, AnyValue args);
     static AnyValue final(AbstractDBInterface &db, AnyValue args);
     
     static AnyValue distance(AbstractDBInterface &db, AnyValue args);
@@ -35,9 +40,32 @@ struct LogisticRegressionCG {
  */
 struct LogisticRegressionIRLS {
     class State;
+    typedef Args<Array<double>, bool, DoubleRow_const> TransitionArgs;
     
     static AnyValue transition(AbstractDBInterface &db, AnyValue args);
+    static bool transitionInPlace(const RawArgument *inArgs,
+        uint16_t inNumArgs);
+    static AnyValue blockTransition(AbstractDBInterface &db, AnyValue args);
     static AnyValue mergeStates(AbstractDBInterface &db, AnyValue args);
+    static AnyValue initialState(AbstractDBInterface &db, AnyValue args);
+    static AnyValue final(AbstractDBInterface &db, AnyValue args);
+    
+    static AnyValue distance(AbstractDBInterface &db, AnyValue args);
+    static AnyValue result(AbstractDBInterface &db, AnyValue args);
+};
+
+/**
+ * @brief Functions for logistic regression, using incremental gradient descent
+ */
+struct LogisticRegressionIGD {
+    class State;
+    typedef Args<Array<double>, bool, DoubleRow_const> TransitionArgs;
+    
+    static AnyValue transition(AbstractDBInterface &db, AnyValue args);
+    static bool transitionInPlace(const RawArgument *inArgs,
+        uint16_t inNumArgs);
+    static AnyValue mergeStates(AbstractDBInterface &db, AnyValue args);
+    static AnyValue initialState(AbstractDBInterface &db, AnyValue args);
     static AnyValue final(AbstractDBInterface &db, AnyValue args);
     
     static AnyValue distance(AbstractDBInterface &db, AnyValue args);
@@ -14,3 +14,4 @@
 
 #include <modules/regress/linear.hpp>
 #include <modules/regress/logistic.hpp>
+#include <modules/regress/design_matrix.hpp>
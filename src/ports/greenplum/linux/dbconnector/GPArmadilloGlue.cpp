@@ -57,6 +57,8 @@ extern "C" {
     #include <utils/elog.h>
 } // extern "C"
 
+#include <utils/LapackTimer.hpp>
+
 namespace madlib {
 
 namespace dbconnector {
@@ -108,7 +110,7 @@ static void *getFnHandle(const char *inFnName) {
 
 #define MADLIB_FORTRAN_QUALIFIER
 
-#define MADLIB_FORTRAN_DECLARE(x) { x; }
+#define MADLIB_FORTRAN_DECLARE(x) { utils::LapackTimer timer; x; }
 
 #define MADLIB_FORTRAN(function) \
     MADLIB_FORTRAN_INIT(madlib_##function, function) \
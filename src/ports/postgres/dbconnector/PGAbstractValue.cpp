@@ -22,20 +22,47 @@ namespace dbconnector {
 
 /**
  * @brief Convert postgres Datum into a ConcreteValue object.
+ *
+ * Type information is looked up in the system catalog. If the type is known to
+ * be constant (as for function arguments), use the overload taking a
+ * PGArgumentInfo instead.
  */
 AbstractValueSPtr PGAbstractValue::DatumToValue(bool inMemoryIsWritable,
     Oid inTypeID, Datum inDatum) const {
     
-    bool isTuple;
-    bool isArray;
+    PGArgumentInfo argInfo;
+    bool errorOccurred = false;
+    
+    argInfo.typeID = inTypeID;
+    argInfo.writable = inMemoryIsWritable;
+    
+    PG_TRY(); {
+        argInfo.isTuple = type_is_rowtype(inTypeID);
+        argInfo.elementTypeID = get_element_type(inTypeID);
+    } PG_CATCH(); {
+        errorOccurred = true;
+    } PG_END_TRY();
+    
+    BOOST_ASSERT_MSG(errorOccurred == false, "An exception occurred while "
+        "converting a PostgreSQL datum to DBAL object.");
+    
+    return DatumToValue(argInfo, inDatum);
+}
+
+/**
+ * @brief Convert postgres Datum with previously resolved type into a
+ *        ConcreteValue object.
+ */
+AbstractValueSPtr PGAbstractValue::DatumToValue(const PGArgumentInfo &inArgInfo,
+    Datum inDatum) const {
+    
+    bool isTuple = inArgInfo.isTuple;
+    bool isArray = inArgInfo.elementTypeID != InvalidOid;
     HeapTupleHeader pgTuple;
     ArrayType *pgArray;
     bool errorOccurred = false;
     
     PG_TRY(); {
-        isTuple = type_is_rowtype(inTypeID);
-        isArray = type_is_array(inTypeID);
-        
         if (isTuple)
             pgTuple = DatumGetHeapTupleHeader(inDatum);
         else if (isArray)
@@ -61,7 +88,7 @@ AbstractValueSPtr PGAbstractValue::DatumToValue(bool inMemoryIsWritable,
             case FLOAT8OID: {
                 MemHandleSPtr memoryHandle(new PGArrayHandle(pgArray));
                 
-                if (inMemoryIsWritable) {
+                if (inArgInfo.writable) {
                     return AbstractValueSPtr(
                         new ConcreteValue<Array<double> >(
                             Array<double>(memoryHandle,
@@ -81,7 +108,7 @@ AbstractValueSPtr PGAbstractValue::DatumToValue(bool inMemoryIsWritable,
         }
     }
 
-    switch (inTypeID) {
+    switch (inArgInfo.typeID) {
         case BOOLOID: return AbstractValueSPtr(
             new ConcreteValue<bool>( DatumGetBool(inDatum) ));
         case INT2OID: return AbstractValueSPtr(
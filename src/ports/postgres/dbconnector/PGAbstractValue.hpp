@@ -8,6 +8,7 @@
 #define MADLIB_POSTGRES_PGABSTRACTVALUE_HPP
 
 #include <dbconnector/PGCommon.hpp>
+#include <dbconnector/PGFunctionCache.hpp>
 
 namespace madlib {
 
@@ -26,6 +27,7 @@ class PGAbstractValue : public AbstractValue {
 protected:
     AbstractValueSPtr getValueByID(unsigned int inID) const = 0;
     AbstractValueSPtr DatumToValue(bool inMemoryIsWritable, Oid inTypeID, Datum inDatum) const;
+    AbstractValueSPtr DatumToValue(const PGArgumentInfo &inArgInfo, Datum inDatum) const;
 };
 
 } // namespace dbconnector
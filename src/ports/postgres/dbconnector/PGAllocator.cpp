@@ -2,6 +2,7 @@
 #include <dbconnector/PGAllocator.hpp>
 #include <dbconnector/PGArrayHandle.hpp>
 #include <dbconnector/PGInterface.hpp>
+#include <dbconnector/PGProfile.hpp>
 
 extern "C" {
     #include <postgres.h>
@@ -72,6 +73,8 @@ void *PGAllocator::allocate(const uint32_t inSize) const throw(std::bad_alloc) {
     MemoryContext oldContext = NULL;
     MemoryContext aggContext = NULL;
 
+    PGProfile::countAllocation(inSize);
+
     PG_TRY(); {
         if (mContext == kAggregate) {
             if (!AggCheckCallContext(mPGInterface->fcinfo, &aggContext))
@@ -147,6 +150,8 @@ void *PGAllocator::allocate(const uint32_t inSize, const std::nothrow_t&) const
     MemoryContext oldContext = NULL;
     MemoryContext aggContext = NULL;
     
+    PGProfile::countAllocation(inSize);
+
     /*
      * HOLD_INTERRUPTS() and RESUME_INTERRUPTS() only change the value of a
      * global variable but have no other side effects. In particular, they do
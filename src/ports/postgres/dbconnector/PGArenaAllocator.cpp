@@ -0,0 +1,291 @@
+/* ----------------------------------------------------------------------- *//**
+ *
+ * @file PGArenaAllocator.cpp
+ *
+ * @brief Bump allocator for short-lived C++ objects
+ *
+ *//* ----------------------------------------------------------------------- */
+
+#include <dbconnector/PGArenaAllocator.hpp>
+#include <dbconnector/PGAllocator.hpp>
+#include <dbconnector/PGProfile.hpp>
+
+#include <algorithm>
+#include <limits>
+
+extern "C" {
+    #include <access/xact.h>
+} // extern "C"
+
+namespace madlib {
+
+namespace dbconnector {
+
+PGArenaAllocator *PGArenaAllocator::sActive = NULL;
+PGArenaAllocator::Activation
+    PGArenaAllocator::sActivations[PGArenaAllocator::kMaxNesting];
+uint16_t PGArenaAllocator::sNumActivations = 0;
+
+namespace {
+
+/**
+ * @brief Transaction callback: No arena survives an aborted transaction
+ */
+void arenaXactCallback(XactEvent inEvent, void * /* inArg */) {
+    if (inEvent == XACT_EVENT_ABORT)
+        PGArenaAllocator::deactivateAbandoned(0);
+}
+
+/**
+ * @brief Subtransaction callback: Arenas created within the aborted
+ *     subtransaction are gone, those of enclosing (sub)transactions are not
+ */
+void arenaSubXactCallback(SubXactEvent inEvent,
+    SubTransactionId /* inMySubid */, SubTransactionId /* inParentSubid */,
+    void * /* inArg */) {
+
+    if (inEvent == SUBXACT_EVENT_ABORT_SUB)
+        PGArenaAllocator::deactivateAbandoned(
+            GetCurrentTransactionNestLevel());
+}
+
+} // namespace
+
+/**
+ * @brief Create an empty arena and make it the active arena
+ *
+ * No memory is requested until the first allocation. If kMaxNesting arenas
+ * are active already, the new arena is not activated.
+ */
+PGArenaAllocator::PGArenaAllocator()
+  : mActivated(sNumActivations < kMaxNesting),
+    mBlock(NULL),
+    mNext(NULL),
+    mLastAllocation(NULL) {
+
+    if (!mActivated)
+        return;
+
+    sActivations[sNumActivations].arena = this;
+    sActivations[sNumActivations].nestLevel
+        = GetCurrentTransactionNestLevel();
+    sNumActivations++;
+    sActive = this;
+}
+
+/**
+ * @brief Make the previously active arena the active arena again
+ *
+ * The blocks are not freed here. They are part of the memory context and
+ * will be released by PostgreSQL.
+ */
+PGArenaAllocator::~PGArenaAllocator() {
+    if (!mActivated)
+        return;
+
+    BOOST_ASSERT_MSG(sActive == this, "Internal error: Arenas must be "
+        "deactivated in reverse order of activation");
+
+    sNumActivations--;
+    sActive = sNumActivations > 0
+        ? sActivations[sNumActivations - 1].arena
+        : NULL;
+}
+
+/**
+ * @brief Install the (sub)transaction-abort callbacks. Called once, when the
+ *     library is loaded.
+ */
+void PGArenaAllocator::registerCallbacks() {
+    RegisterXactCallback(arenaXactCallback, NULL);
+    RegisterSubXactCallback(arenaSubXactCallback, NULL);
+}
+
+/**
+ * @brief Deactivate all arenas created at the given transaction nest level or
+ *     deeper
+ *
+ * Called when the (sub)transaction at nest level \c inNestLevel aborts. The
+ * stack frames of these arenas have been left by \c longjmp(), so only the
+ * static stack of activations is read. Their blocks are released together
+ * with the memory context. PGProfile::CallScope keeps no static state, so an
+ * abandoned profile scope merely goes unrecorded.
+ */
+void PGArenaAllocator::deactivateAbandoned(int inNestLevel) throw() {
+    while (sNumActivations > 0
+        && sActivations[sNumActivations - 1].nestLevel >= inNestLevel)
+        sNumActivations--;
+
+    sActive = sNumActivations > 0
+        ? sActivations[sNumActivations - 1].arena
+        : NULL;
+}
+
+/**
+ * @brief Allocate a double array
+ *
+ * Arrays may be returned to the backend, so they are never allocated in the
+ * arena.
+ */
+MemHandleSPtr PGArenaAllocator::allocateArray(uint32_t inNumElements,
+    double * /* ignored */) const {
+
+    return PGAllocator::defaultAllocator().allocateArray(inNumElements,
+        static_cast<double*>(NULL));
+}
+
+/**
+ * @brief Allocate memory. Throws on fail.
+ */
+void *PGArenaAllocator::allocate(const uint32_t inSize) const
+    throw(std::bad_alloc) {
+
+    if (inSize > kMaxSmallAllocation)
+        return allocatePassThrough(inSize, true);
+
+    return allocateSmall(inSize, true);
+}
+
+/**
+ * @brief Allocate memory. Never throws.
+ *
+ * @note This function is also called by operator new (std::nothrow), which must
+ *       not throw *any* exception.
+ */
+void *PGArenaAllocator::allocate(const uint32_t inSize, const std::nothrow_t&)
+    const throw() {
+
+    if (inSize > kMaxSmallAllocation)
+        return allocatePassThrough(inSize, false);
+
+    return allocateSmall(inSize, false);
+}
+
+/**
+ * @brief Free a block of memory previously allocated with allocate()
+ *
+ * See release().
+ *
+ * @note This function is also called by operator delete, which must not throw
+ *       *any* exceptions.
+ */
+void PGArenaAllocator::free(void *inPtr) const throw() {
+    release(inPtr);
+}
+
+/**
+ * @brief Free memory allocated by allocate() or allocatePassThrough()
+ *
+ * Memory in an arena block is only reclaimed if it was the most recent
+ * allocation of an active arena. Memory that was passed through is freed by
+ * PGAllocator. This takes constant time (apart from the usually very short
+ * list of active arenas), so operator delete calls this function whether or
+ * not there is an active arena.
+ *
+ * Memory without a valid header is freed by PGAllocator. This only happens if
+ * memory not allocated by operator new is freed with operator delete.
+ */
+void PGArenaAllocator::release(void *inPtr) throw() {
+    if (inPtr == NULL)
+        return;
+
+    Header *header = static_cast<Header*>(inPtr) - 1;
+    if (header->self != header
+        || (header->tag != kSmallTag && header->tag != kLargeTag)) {
+
+        PGAllocator::defaultAllocator().free(inPtr);
+        return;
+    }
+
+    if (header->tag == kLargeTag) {
+        header->tag = 0;
+        PGAllocator::defaultAllocator().free(header);
+        return;
+    }
+
+    for (uint16_t i = sNumActivations; i > 0; i--) {
+        const PGArenaAllocator *arena = sActivations[i - 1].arena;
+
+        if (inPtr == arena->mLastAllocation) {
+            arena->mNext = reinterpret_cast<char*>(header);
+            arena->mLastAllocation = NULL;
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Write a header at the beginning of the given memory, and return the
+ *        memory after it
+ */
+void *PGArenaAllocator::tag(void *inMemory, uint64_t inTag) {
+    if (inMemory == NULL)
+        return NULL;
+
+    Header *header = static_cast<Header*>(inMemory);
+    header->tag = inTag;
+    header->self = header;
+    return header + 1;
+}
+
+/**
+ * @brief Pass an allocation through to PGAllocator, prepending a header
+ *
+ * @param inSize Number of bytes
+ * @param inThrow Whether to throw std::bad_alloc (or to return NULL) if the
+ *     memory cannot be allocated
+ */
+void *PGArenaAllocator::allocatePassThrough(std::size_t inSize, bool inThrow) {
+    std::size_t size = inSize + sizeof(Header);
+
+    if (size > std::numeric_limits<uint32_t>::max()) {
+        if (inThrow)
+            throw std::bad_alloc();
+        return NULL;
+    }
+
+    return tag(inThrow
+        ? PGAllocator::defaultAllocator().allocate(size)
+        : PGAllocator::defaultAllocator().allocate(size, std::nothrow),
+        kLargeTag);
+}
+
+/**
+ * @brief Bump-allocate from the current block, starting a new block if the
+ *        request does not fit
+ *
+ * @param inSize Number of bytes (at most kMaxSmallAllocation)
+ * @param inThrow Whether to throw std::bad_alloc (or to return NULL) if a new
+ *     block cannot be allocated
+ */
+void *PGArenaAllocator::allocateSmall(std::size_t inSize, bool inThrow) const {
+    std::size_t size = sizeof(Header)
+        + alignedSize(std::max<std::size_t>(inSize, 1));
+
+    if (mBlock == NULL || size > static_cast<std::size_t>(mBlock->end - mNext)) {
+        void *memory = inThrow
+            ? PGAllocator::defaultAllocator().allocate(kBlockSize)
+            : PGAllocator::defaultAllocator().allocate(kBlockSize,
+                std::nothrow);
+        if (memory == NULL)
+            return NULL;
+
+        // palloc() only guarantees MAXALIGN, so we align the first
+        // allocation ourselves.
+        Block *block = static_cast<Block*>(memory);
+        block->previous = mBlock;
+        block->end = static_cast<char*>(memory) + kBlockSize;
+        mBlock = block;
+        mNext = reinterpret_cast<char*>(alignedSize(
+            reinterpret_cast<std::size_t>(block + 1)));
+    }
+
+    mLastAllocation = static_cast<char*>(tag(mNext, kSmallTag));
+    mNext += size;
+    PGProfile::countArenaAllocation(inSize);
+    return mLastAllocation;
+}
+
+} // namespace dbconnector
+
+} // namespace madlib
@@ -0,0 +1,158 @@
+/* ----------------------------------------------------------------------- *//**
+ *
+ * @file PGArenaAllocator.hpp
+ *
+ * @brief Bump allocator for short-lived C++ objects
+ *
+ *//* ----------------------------------------------------------------------- */
+
+#ifndef MADLIB_POSTGRES_PGARENAALLOCATOR_HPP
+#define MADLIB_POSTGRES_PGARENAALLOCATOR_HPP
+
+#include <dbconnector/PGCommon.hpp>
+
+namespace madlib {
+
+namespace dbconnector {
+
+/**
+ * @brief Arena (bump) allocator for the C++ objects of a single UDF call
+ *
+ * Every call of operator new would otherwise go through
+ * PGAllocator::allocate(), i.e., through \c PG_TRY() and \c palloc(). Most of
+ * these allocations are small and short-lived: shared_ptr control blocks,
+ * memory handles, AnyValue wrappers, Armadillo temporaries. The arena instead
+ * requests blocks of kBlockSize bytes from the memory context that is current
+ * when the arena is created (for a UDF call, the per-call context) and hands
+ * out memory from them by incrementing a pointer.
+ *
+ * free() does not return memory to PostgreSQL. The blocks are released when
+ * PostgreSQL resets the memory context. As an exception, freeing the most
+ * recent allocation rewinds the arena, so that the common pattern of creating
+ * and destroying a temporary does not consume memory in loops. Requests larger
+ * than kMaxSmallAllocation bytes are passed through to PGAllocator, and so is
+ * freeing them.
+ *
+ * Every allocation made by operator new is preceded by a Header, which tells
+ * free() in constant time whether the memory is part of an arena block or
+ * whether it needs to be freed by PGAllocator. Without an active arena,
+ * operator new therefore calls allocatePassThrough().
+ *
+ * While an arena is alive, it is the active arena, and the global operator
+ * new and operator delete use it (see PGNewDelete.cpp). Arenas are activated
+ * and deactivated in stack order; PGInterface creates one for every call.
+ *
+ * Memory that might be passed to the PostgreSQL backend (arrays, transition
+ * states) must \b not come from the arena, because the backend may call
+ * \c pfree() on it (e.g., on the previous transition state of an aggregate).
+ * Therefore, allocateArray() is passed through to PGAllocator, and
+ * PGAllocator::defaultAllocator() does not use the arena.
+ *
+ * If the backend aborts a (sub)transaction with a \c longjmp() through C++
+ * frames, the destructors of the arenas on these frames never run. We
+ * therefore keep the stack of activated arenas (together with the transaction
+ * nest level each was created at) in static memory, and the callbacks
+ * installed by registerCallbacks() pop the arenas of an aborted
+ * (sub)transaction without touching their abandoned stack frames. At most
+ * kMaxNesting arenas can be active at a time; deeper nested arenas are never
+ * activated, so that their C++ objects come from the innermost active arena.
+ *
+ * @internal Only one thread may call into the backend, so it is safe to keep
+ *     the active arenas in static variables.
+ */
+class PGArenaAllocator : public AbstractAllocator {
+public:
+    enum {
+        kBlockSize = 8192,
+        kMaxSmallAllocation = 1024,
+        kAlignment = 16,
+        kMaxNesting = 32
+    };
+
+    PGArenaAllocator();
+    ~PGArenaAllocator();
+
+    /**
+     * @brief Return the active arena, or NULL if there is none
+     */
+    static PGArenaAllocator *active() {
+        return sActive;
+    }
+
+    MemHandleSPtr allocateArray(
+        uint32_t inNumElements, double * /* ignored */) const;
+
+    void *allocate(const uint32_t inSize) const throw(std::bad_alloc);
+
+    void *allocate(const uint32_t inSize, const std::nothrow_t&) const
+        throw();
+
+    void free(void *inPtr) const throw();
+
+    static void *allocatePassThrough(std::size_t inSize, bool inThrow);
+
+    static void release(void *inPtr) throw();
+
+    static void registerCallbacks();
+
+    static void deactivateAbandoned(int inNestLevel) throw();
+
+private:
+    // Arenas cannot be copied
+    PGArenaAllocator(const PGArenaAllocator &);
+    PGArenaAllocator &operator=(const PGArenaAllocator &);
+
+    /**
+     * @brief Header of an arena block. The usable memory follows the header.
+     */
+    struct Block {
+        Block *previous;
+        char *end;
+    };
+
+    /**
+     * @brief Header of every allocation made through an arena
+     *
+     * The second field guards against a tag that happens to be in memory in
+     * front of a pointer that was not allocated by operator new. The size of
+     * the header is a multiple of kAlignment.
+     */
+    struct Header {
+        uint64_t tag;
+        const Header *self;
+    };
+
+    static const uint64_t kSmallTag = 0xFFFF5A11A7E4A000ULL;
+    static const uint64_t kLargeTag = 0xFFFF1A46E0A7E400ULL;
+
+    static std::size_t alignedSize(std::size_t inSize) {
+        return (inSize + kAlignment - 1) & ~static_cast<std::size_t>(
+            kAlignment - 1);
+    }
+
+    void *allocateSmall(std::size_t inSize, bool inThrow) const;
+    static void *tag(void *inMemory, uint64_t inTag);
+
+    /**
+     * @brief Entry of the stack of activated arenas
+     */
+    struct Activation {
+        PGArenaAllocator *arena;
+        int nestLevel;
+    };
+
+    static PGArenaAllocator *sActive;
+    static Activation sActivations[kMaxNesting];
+    static uint16_t sNumActivations;
+
+    bool mActivated;
+    mutable Block *mBlock;
+    mutable char *mNext;
+    mutable char *mLastAllocation;
+};
+
+} // namespace dbconnector
+
+} // namespace madlib
+
+#endif
@@ -30,6 +30,7 @@ using namespace dbal;
 using namespace utils::memory;
 
 typedef AnyValue (MADFunction)(AbstractDBInterface &, AnyValue);
+typedef bool (MADInPlaceFunction)(const RawArgument *, uint16_t);
 
 // Forward declarations
 // ====================
@@ -6,6 +6,8 @@
 extern "C" {
     #include <fmgr.h>
     #include <utils/lsyscache.h>    // because of type_is_array
+    #include <catalog/pg_type.h>    // because of FLOAT8ARRAYOID
+    #include <executor/spi.h>       // because of SPIPlanPtr
 } // extern "C"
 
 namespace madlib {
@@ -37,6 +39,22 @@ int AggCheckCallContext(FunctionCallInfo fcinfo, MemoryContext *aggcontext);
 
 #endif // PG_VERSION_NUM < 90000
 
+#if PG_VERSION_NUM < 80300
+
+/*
+ * Before PostgreSQL 8.3, SPI plans were untyped pointers.
+ */
+typedef void *SPIPlanPtr;
+
+#endif // PG_VERSION_NUM < 80300
+
+/*
+ * Older versions of pg_type.h do not define the OIDs of most array types.
+ */
+#ifndef FLOAT8ARRAYOID
+    #define FLOAT8ARRAYOID 1022
+#endif
+
 } // namespace dbconnector
 
 } // namespace madlib
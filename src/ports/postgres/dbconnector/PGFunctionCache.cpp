@@ -0,0 +1,173 @@
+/* ----------------------------------------------------------------------- *//**
+ *
+ * @file PGFunctionCache.cpp
+ *
+ * @brief Per-call-site caching of function meta data
+ *
+ *//* ----------------------------------------------------------------------- */
+
+#include <dbconnector/PGCompatibility.hpp>
+#include <dbconnector/PGFunctionCache.hpp>
+
+#include <stdexcept>
+
+extern "C" {
+    #include <utils/lsyscache.h>
+    #include <utils/memutils.h>
+    #include <utils/typcache.h>
+}
+
+
+namespace madlib {
+
+namespace dbconnector {
+
+/**
+ * @brief Return the cache of the current call site, creating it if necessary
+ *
+ * On the first call, the types of all arguments are resolved. All subsequent
+ * calls only dereference \c flinfo->fn_extra.
+ *
+ * @see PGInterface for information on necessary precautions when writing
+ *      PostgreSQL plug-in code in C++.
+ */
+PGFunctionCache *PGFunctionCache::get(FunctionCallInfo fcinfo) {
+    if (fcinfo == NULL || fcinfo->flinfo == NULL)
+        throw std::invalid_argument("Function call information is not "
+            "available");
+
+    PGFunctionCache *cache
+        = static_cast<PGFunctionCache*>(fcinfo->flinfo->fn_extra);
+    if (cache != NULL)
+        return cache;
+
+    bool exceptionOccurred = false;
+    int numArgs = PG_NARGS();
+    int i;
+
+    PG_TRY(); {
+        cache = static_cast<PGFunctionCache*>(
+            MemoryContextAllocZero(fcinfo->flinfo->fn_mcxt,
+                sizeof(PGFunctionCache) + numArgs * sizeof(PGArgumentInfo)));
+        cache->numArgs = numArgs;
+        cache->args = reinterpret_cast<PGArgumentInfo*>(cache + 1);
+
+        for (i = 0; i < numArgs; i++) {
+            cache->args[i].typeID = get_fn_expr_argtype(fcinfo->flinfo, i);
+            if (cache->args[i].typeID == InvalidOid)
+                continue;
+
+            cache->args[i].isTuple = type_is_rowtype(cache->args[i].typeID);
+            cache->args[i].elementTypeID
+                = get_element_type(cache->args[i].typeID);
+        }
+
+        // If we are called as an aggregate function, the first argument is the
+        // transition state. In that case, we are free to modify the data.
+        // In fact, for performance reasons, we *should* even do all
+        // modifications in-place. In all other cases, directly modifying
+        // memory is dangerous. See warning at:
+        // http://www.postgresql.org/docs/current/static/xfunc-c.html#XFUNC-C-BASETYPE
+        if (numArgs > 0)
+            cache->args[0].writable = AggCheckCallContext(fcinfo, NULL);
+
+        fcinfo->flinfo->fn_extra = cache;
+    } PG_CATCH(); {
+        exceptionOccurred = true;
+    } PG_END_TRY();
+
+    BOOST_ASSERT_MSG(exceptionOccurred == false, "An exception occurred while "
+        "gathering inormation about PostgreSQL function arguments");
+
+    return cache;
+}
+
+/**
+ * @brief Resolve the type information of a (possibly composite) type
+ *
+ * Tuple descriptors and attribute information are allocated in the current
+ * memory context. Composite types are resolved recursively.
+ *
+ * @param outTypeInfo Type information to fill
+ * @param inTypeID Type to resolve
+ * @param inTupleDesc Tuple descriptor if already known (it will be copied),
+ *     NULL otherwise
+ *
+ * @internal This function must only be called from within a PG_TRY block, and
+ *     it never throws C++ exceptions.
+ */
+static void resolveTypeInfo(PGTypeInfo &outTypeInfo, Oid inTypeID,
+    TupleDesc inTupleDesc) {
+
+    outTypeInfo.typeID = inTypeID;
+    outTypeInfo.elementTypeID = get_element_type(inTypeID);
+    outTypeInfo.tupleDesc = NULL;
+    outTypeInfo.attributes = NULL;
+
+    if (inTupleDesc != NULL) {
+        outTypeInfo.tupleDesc = CreateTupleDescCopy(inTupleDesc);
+    } else if (type_is_rowtype(inTypeID)) {
+        // Don't ereport errors. We set typmod < 0, and this should not cause
+        // an error because compound types in another compund can never be
+        // transient. (I think)
+        TupleDesc tupleDesc = lookup_rowtype_tupdesc_noerror(inTypeID, -1,
+            true);
+        if (tupleDesc != NULL) {
+            outTypeInfo.tupleDesc = CreateTupleDescCopy(tupleDesc);
+            ReleaseTupleDesc(tupleDesc);
+        }
+    }
+
+    if (outTypeInfo.tupleDesc == NULL)
+        return;
+
+    // Blessing is only necessary for transient record types, but it is cheap
+    // and happens only once per call site
+    outTypeInfo.tupleDesc = BlessTupleDesc(outTypeInfo.tupleDesc);
+    outTypeInfo.attributes = static_cast<PGTypeInfo*>(
+        palloc0(outTypeInfo.tupleDesc->natts * sizeof(PGTypeInfo)));
+    for (int i = 0; i < outTypeInfo.tupleDesc->natts; i++)
+        resolveTypeInfo(outTypeInfo.attributes[i],
+            outTypeInfo.tupleDesc->attrs[i]->atttypid, NULL);
+}
+
+/**
+ * @brief Return the type information of the return value, resolving it if
+ *        necessary
+ *
+ * get_call_result_type() is tagged as expensive in funcapi.c. We therefore call
+ * it only once per call site, and we also resolve (and bless) the tuple
+ * descriptors of all composite types contained in the return type.
+ *
+ * @see PGInterface for information on necessary precautions when writing
+ *      PostgreSQL plug-in code in C++.
+ */
+const PGTypeInfo &PGFunctionCache::result(FunctionCallInfo fcinfo) {
+    if (resultResolved)
+        return resultInfo;
+
+    bool exceptionOccurred = false;
+    Oid typeID = InvalidOid;
+    TupleDesc tupleDesc = NULL;
+    MemoryContext oldContext = MemoryContextSwitchTo(fcinfo->flinfo->fn_mcxt);
+
+    PG_TRY(); {
+        resultClass = get_call_result_type(fcinfo, &typeID, &tupleDesc);
+        resolveTypeInfo(resultInfo, typeID,
+            resultClass == TYPEFUNC_COMPOSITE ? tupleDesc : NULL);
+        resultResolved = true;
+    } PG_CATCH(); {
+        exceptionOccurred = true;
+    } PG_END_TRY();
+
+    MemoryContextSwitchTo(oldContext);
+
+    BOOST_ASSERT_MSG(exceptionOccurred == false, "An exception occurred while "
+        "gathering information about the PostgreSQL function return type");
+
+    return resultInfo;
+}
+
+} // namespace dbconnector
+
+} // namespace madlib
@@ -0,0 +1,121 @@
+/* ----------------------------------------------------------------------- *//**
+ *
+ * @file PGFunctionCache.hpp
+ *
+ * @brief Header file for per-call-site caching of function meta data
+ *
+ *//* ----------------------------------------------------------------------- */
+
+#ifndef MADLIB_POSTGRES_PGFUNCTIONCACHE_HPP
+#define MADLIB_POSTGRES_PGFUNCTIONCACHE_HPP
+
+#include <dbconnector/PGCommon.hpp>
+
+extern "C" {
+    #include <fmgr.h>
+    #include <funcapi.h>            // TypeFuncClass
+    #include <access/tupdesc.h>     // TupleDesc
+} // extern "C"
+
+namespace madlib {
+
+namespace dbconnector {
+
+/**
+ * @brief Resolved type information of a single function argument
+ */
+struct PGArgumentInfo {
+    /**
+     * @brief Type of the argument, InvalidOid if it could not be determined
+     */
+    Oid typeID;
+
+    /**
+     * @brief Element type if the argument is an array, InvalidOid otherwise
+     */
+    Oid elementTypeID;
+
+    /**
+     * @brief Whether the argument is of a composite type
+     */
+    bool isTuple;
+
+    /**
+     * @brief Whether we may modify the argument's memory in-place
+     *
+     * This is only true for the transition state of an aggregate function.
+     */
+    bool writable;
+};
+
+/**
+ * @brief Resolved type information of a return value (or of an attribute of a
+ *        composite return value)
+ */
+struct PGTypeInfo {
+    /**
+     * @brief Type of the value
+     */
+    Oid typeID;
+
+    /**
+     * @brief Element type if the value is an array, InvalidOid otherwise
+     */
+    Oid elementTypeID;
+
+    /**
+     * @brief Blessed tuple descriptor if the value is of a composite type,
+     *        NULL otherwise
+     */
+    TupleDesc tupleDesc;
+
+    /**
+     * @brief Type information of the attributes (tupleDesc->natts many) if the
+     *        value is of a composite type, NULL otherwise
+     */
+    PGTypeInfo *attributes;
+};
+
+/**
+ * @brief Meta data of a function call site, stored in \c flinfo->fn_extra
+ *
+ * PostgreSQL keeps the FmgrInfo of a function call site alive across calls,
+ * e.g., for all invocations of an aggregate's transition function during one
+ * scan. Everything that is constant for a call site should therefore be looked
+ * up only once and then be retrieved from here. In particular, the type
+ * information of all arguments is resolved on the first call, and the type
+ * information of the return value (including blessed tuple descriptors for
+ * composite types) is resolved on the first call of result().
+ *
+ * @internal The cache lives in \c flinfo->fn_mcxt, i.e., it is plain old data
+ *     without destructors. PostgreSQL will simply garbage-collect it together
+ *     with the FmgrInfo.
+ */
+struct PGFunctionCache {
+    static PGFunctionCache *get(FunctionCallInfo fcinfo);
+
+    /**
+     * @brief Type information of the <tt>inID</tt>-th argument
+     */
+    const PGArgumentInfo &argument(unsigned int inID) const {
+        return args[inID];
+    }
+
+    const PGTypeInfo &result(FunctionCallInfo fcinfo);
+
+    int numArgs;
+    PGArgumentInfo *args;
+
+    /**
+     * @brief Whether resultClass and resultInfo have been initialized
+     */
+    bool resultResolved;
+    TypeFuncClass resultClass;
+    PGTypeInfo resultInfo;
+};
+
+} // namespace dbconnector
+
+} // namespace madlib
+
+#endif
@@ -11,7 +11,7 @@ inline AllocatorSPtr PGInterface::allocator(
     return AllocatorSPtr(new PGAllocator(this, inMemContext));
 }
 
-inline void PGInterface::PGOutputStreamBuffer::output(
+inline void PGOutputStreamBuffer::output(
     char *inMsg, uint32_t /* inLength */) {
 
     bool errorOccurred = false;
@@ -12,6 +12,43 @@ namespace madlib {
 
 namespace dbconnector {
 
+/**
+ * @brief Stream buffer that dispatches all output to PostgreSQL's ereport
+ *        function
+ */
+class PGOutputStreamBuffer : public AbstractOutputStreamBuffer<char> {
+public:
+    PGOutputStreamBuffer(int inErrorLevel) : mErrorLevel(inErrorLevel) { }
+
+    /**
+     * @brief Output a null-terminated C string.
+     *
+     * @param inMsg Null-terminated C string
+     * @param inLength length of inMsg
+     */
+    void output(char *inMsg, uint32_t inLength);
+
+private:
+    int mErrorLevel;
+};
+
+/**
+ * @brief Stream buffers of a PGInterface
+ *
+ * PGInterface derives from this class before AbstractDBInterface, so that the
+ * stream buffers are constructed before they are passed to the
+ * AbstractDBInterface constructor ("base-from-member" idiom). This way, they
+ * do not have to be allocated on the heap.
+ */
+struct PGOutputStreamBuffers {
+    PGOutputStreamBuffers()
+    :   mInfoBuffer(INFO),
+        mWarningBuffer(WARNING) { }
+
+    PGOutputStreamBuffer mInfoBuffer;
+    PGOutputStreamBuffer mWarningBuffer;
+};
+
 /**
  * @brief PostgreSQL database interface
  *
@@ -44,54 +81,36 @@ namespace dbconnector {
  *    essentially an \b additional protection against leaking C++ code. Given
  *    1., no C++ destructor call will ever be missed.)
  *
+ * A PGInterface is constructed for every call of a UDF (i.e., for every row
+ * in case of an aggregate transition function). Construction therefore has to
+ * be cheap: The stream buffers are not allocated on the heap, and they
+ * allocate their character buffers only on first output (see
+ * AbstractOutputStreamBuffer). A function that never writes to \c out or
+ * \c err does not cause any heap allocation for logging.
+ *
  * @see PGAllocator
  */
-class PGInterface : public AbstractDBInterface {
+class PGInterface
+  : private PGOutputStreamBuffers,
+    public AbstractDBInterface {
+
     friend class PGAllocator;
 
 public:
     PGInterface(const FunctionCallInfo inFCinfo)
-    :   AbstractDBInterface(
-            new PGOutputStreamBuffer(INFO),
-            new PGOutputStreamBuffer(WARNING)),
+    :   PGOutputStreamBuffers(),
+        AbstractDBInterface(&mInfoBuffer, &mWarningBuffer),
         fcinfo(inFCinfo) {
         
         // Observe: This only works because PostgreSQL does not use multiple
         // threads for UDFs
         arma::set_log_stream(mArmadilloOut);
     }
-
-    ~PGInterface() {
-        // We allocated the streambuf objects in the initialization list of
-        // the constructor. Hence, we also have to clean them up.
-        delete out.rdbuf();
-        delete err.rdbuf();
-    }
     
     AllocatorSPtr allocator(
         AbstractAllocator::Context inMemContext = AbstractAllocator::kFunction);
     
 private:
-    /**
-     * @brief Stream buffer that dispatches all output to PostgreSQL's ereport
-     *        function
-     */
-    class PGOutputStreamBuffer : public AbstractOutputStreamBuffer<char> {
-    public:
-        PGOutputStreamBuffer(int inErrorLevel) : mErrorLevel(inErrorLevel) { }
-    
-        /**
-         * @brief Output a null-terminated C string.
-         *
-         * @param inMsg Null-terminated C string
-         * @param inLength length of inMsg
-         */
-        void output(char *inMsg, uint32_t inLength);
-        
-    private:
-        int mErrorLevel;
-    };
-
     /**
      * @internal The name is chosen so that PostgreSQL macros like \c PG_NARGS
      *           can be used.
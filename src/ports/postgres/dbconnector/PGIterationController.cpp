@@ -0,0 +1,189 @@
+/* ----------------------------------------------------------------------- *//**
+ *
+ * @file PGIterationController.cpp
+ *
+ * @brief Driver for iterative algorithms whose state is a DOUBLE PRECISION
+ *     array
+ *
+ *//* ----------------------------------------------------------------------- */
+
+#include <dbconnector/PGCompatibility.hpp>
+
+#include <cstring>
+
+extern "C" {
+    #include <funcapi.h>
+    #include <access/htup.h>
+    #include <miscadmin.h>          // for CHECK_FOR_INTERRUPTS
+    #include <utils/builtins.h>     // for textout
+} // extern "C"
+
+namespace madlib {
+
+namespace dbconnector {
+
+// Like the functions in PGProfile.cpp, the functions below are called directly
+// by the database. They do not create C++ objects and therefore may call into
+// the backend (here: the SPI) without PG_TRY().
+
+/**
+ * @brief Copy a state into the memory context of the caller
+ *
+ * SPI_palloc() allocates in the memory context that was current before
+ * SPI_connect(), so the copy survives SPI_freetuptable() and SPI_finish().
+ */
+static Datum
+copyStateToUpperContext(Datum inState) {
+    struct varlena *state = PG_DETOAST_DATUM(inState);
+    Size size = VARSIZE(state);
+    void *copy = SPI_palloc(size);
+
+    std::memcpy(copy, state, size);
+    return PointerGetDatum(copy);
+}
+
+/**
+ * @brief Return the result column of a query that returns exactly one row
+ *     with one column
+ */
+static Datum
+getSingleValue(const char *inWhat, bool *outIsNull) {
+    if (SPI_processed != 1 || SPI_tuptable == NULL
+        || SPI_tuptable->tupdesc->natts != 1)
+        ereport(ERROR,
+            (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+             errmsg("%s query must return exactly one row with one column",
+                inWhat)));
+
+    return SPI_getbinval(SPI_tuptable->vals[0], SPI_tuptable->tupdesc, 1,
+        outIsNull);
+}
+
+extern "C" {
+
+Datum internal_execute_iterative_alg(PG_FUNCTION_ARGS);
+PG_FUNCTION_INFO_V1(internal_execute_iterative_alg);
+
+/**
+ * @brief Run an iterative algorithm and return the number of iterations and
+ *     the final state
+ *
+ * Arguments:
+ * -# initialState (DOUBLE PRECISION[], may be NULL)
+ * -# updateQuery (TEXT): Query that returns one row with the new state. The
+ *    previous state is passed as parameter $1.
+ * -# distanceFunction (REGPROCEDURE, may be NULL): Function of type
+ *    (DOUBLE PRECISION[], DOUBLE PRECISION[]) -> DOUBLE PRECISION. It is called
+ *    with the new and the previous state. If NULL, the algorithm only
+ *    terminates after maxNumIterations iterations.
+ * -# precision (DOUBLE PRECISION): Terminate once the distance between
+ *    successive states is less than this value
+ * -# maxNumIterations (INTEGER)
+ *
+ * Like the driver this replaces (which stored every state in a temporary table
+ * and joined it with the source relation), we terminate at the earliest after
+ * the second iteration.
+ *
+ * The update query is prepared once. The states are kept in the memory of the
+ * caller, and only the previous and the current state are alive at any time.
+ * Distances are computed by calling the distance function directly.
+ */
+Datum
+internal_execute_iterative_alg(PG_FUNCTION_ARGS) {
+    Datum state;
+    bool stateIsNull;
+    Datum newState;
+    bool newStateIsNull;
+    char *updateQuery;
+    bool useDistance;
+    FmgrInfo distanceFn;
+    double precision;
+    int32 maxNumIterations;
+    int32 iteration;
+    bool terminate;
+    int spiResult;
+    Oid updateArgTypes[1] = { FLOAT8ARRAYOID };
+    SPIPlanPtr updatePlan;
+    TupleDesc tupleDesc;
+    Datum values[2];
+    bool nulls[2] = { false, false };
+
+    if (PG_ARGISNULL(1) || PG_ARGISNULL(3) || PG_ARGISNULL(4))
+        ereport(ERROR,
+            (errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+             errmsg("update query, precision, and maximum number of "
+                "iterations must not be NULL")));
+
+    if (get_call_result_type(fcinfo, NULL, &tupleDesc) != TYPEFUNC_COMPOSITE)
+        ereport(ERROR,
+            (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+             errmsg("function returning record called in context "
+                "that cannot accept type record")));
+
+    stateIsNull = PG_ARGISNULL(0);
+    state = stateIsNull ? PointerGetDatum(NULL) : PG_GETARG_DATUM(0);
+    updateQuery = DatumGetCString(
+        DirectFunctionCall1(textout, PG_GETARG_DATUM(1)));
+    useDistance = !PG_ARGISNULL(2);
+    if (useDistance)
+        fmgr_info(PG_GETARG_OID(2), &distanceFn);
+    precision = PG_GETARG_FLOAT8(3);
+    maxNumIterations = PG_GETARG_INT32(4);
+
+    if (SPI_connect() != SPI_OK_CONNECT)
+        ereport(ERROR,
+            (errcode(ERRCODE_INTERNAL_ERROR),
+             errmsg("could not connect to SPI manager")));
+
+    updatePlan = SPI_prepare(updateQuery, 1, updateArgTypes);
+    if (updatePlan == NULL)
+        ereport(ERROR,
+            (errcode(ERRCODE_INTERNAL_ERROR),
+             errmsg("could not prepare update query: %s",
+                SPI_result_code_string(SPI_result))));
+
+    for (iteration = 1; ; iteration++) {
+        CHECK_FOR_INTERRUPTS();
+
+        spiResult = SPI_execute_plan(updatePlan, &state,
+            stateIsNull ? "n" : " ", false /* read_only */, 0);
+        if (spiResult != SPI_OK_SELECT)
+            ereport(ERROR,
+                (errcode(ERRCODE_INTERNAL_ERROR),
+                 errmsg("could not execute update query: %s",
+                    SPI_result_code_string(spiResult))));
+
+        newState = getSingleValue("update", &newStateIsNull);
+        if (!newStateIsNull)
+            newState = copyStateToUpperContext(newState);
+        SPI_freetuptable(SPI_tuptable);
+
+        terminate = iteration > 1 && (iteration >= maxNumIterations
+            || (useDistance && !stateIsNull && !newStateIsNull
+                && DatumGetFloat8(FunctionCall2(&distanceFn, newState, state))
+                    < precision));
+
+        // The initial state belongs to the caller
+        if (!stateIsNull && iteration > 1)
+            SPI_pfree(DatumGetPointer(state));
+        state = newState;
+        stateIsNull = newStateIsNull;
+
+        if (terminate)
+            break;
+    }
+
+    SPI_finish();
+
+    values[0] = Int32GetDatum(iteration);
+    values[1] = state;
+    nulls[1] = stateIsNull;
+    PG_RETURN_DATUM(HeapTupleGetDatum(
+        heap_form_tuple(BlessTupleDesc(tupleDesc), values, nulls)));
+}
+
+} // extern "C"
+
+} // namespace dbconnector
+
+} // namespace madlib
@@ -20,6 +20,15 @@ namespace dbconnector {
 
 extern "C" {
     PG_MODULE_MAGIC;
+
+    void _PG_init(void);
+
+    /**
+     * @brief Called by the backend when the library is loaded
+     */
+    void _PG_init(void) {
+        PGArenaAllocator::registerCallbacks();
+    }
 } // extern "C"
 
 #define DECLARE_UDF(NameSpace, Function) DECLARE_UDF_EXT(Function, NameSpace, Function)
@@ -35,8 +44,23 @@ extern "C" {
         } \
     }
 
+#define DECLARE_UDF_INPLACE_EXT(SQLName, NameSpace, Function, InPlaceFunction, \
+    InPlaceArgs) \
+    extern "C" { \
+        Datum SQLName(PG_FUNCTION_ARGS); \
+        PG_FUNCTION_INFO_V1(SQLName); \
+        Datum SQLName(PG_FUNCTION_ARGS) { \
+            return callInPlace( \
+                modules::NameSpace::InPlaceFunction, \
+                modules::NameSpace::Function, \
+                modules::NameSpace::InPlaceArgs::kNumArgs, \
+                fcinfo); \
+        } \
+    }
+
 #include <modules/declarations.hpp>
 
+#undef DECLARE_UDF_INPLACE_EXT
 #undef DECLARE_UDF_EXT
 #undef DECLARE_UDF
 
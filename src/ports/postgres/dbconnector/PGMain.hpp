@@ -12,6 +12,8 @@
 #include <dbconnector/PGCommon.hpp>
 #include <dbconnector/PGToDatumConverter.hpp>
 #include <dbconnector/PGInterface.hpp>
+#include <dbconnector/PGArenaAllocator.hpp>
+#include <dbconnector/PGProfile.hpp>
 #include <dbconnector/PGValue.hpp>
 
 extern "C" {
@@ -24,6 +26,27 @@ namespace madlib {
 
 namespace dbconnector {
 
+/**
+ * @brief Report an error to the database. This function does not return.
+ *
+ * @internal ereport will do a longjmp. Hence, the caller must make sure that
+ *     only POD (plain old data) is left on the stack.
+ */
+inline static void raiseError(int sqlerrcode, const char *msg,
+    PG_FUNCTION_ARGS) {
+
+    ereport (
+        ERROR, (
+            errcode(sqlerrcode),
+            errmsg(
+                "Function \"%s\": %s",
+                format_procedure(fcinfo->flinfo->fn_oid),
+                msg
+            )
+        )
+    );
+}
+
 /**
  * @brief C++ entry point for calls from the database
  *
@@ -35,56 +58,121 @@ inline static Datum call(MADFunction &f, PG_FUNCTION_ARGS) {
     char msg[2048];
     Datum datum;
 
-    try {
-        PGInterface db(fcinfo);
-        
-        try {
-            AnyValue result = f(db, PGValue<FunctionCallInfo>(fcinfo));
+    {
+        // All C++ objects created during this call are allocated from the
+        // arena. It (as well as the profile scope) has to be destroyed before
+        // we call raiseError() (which does not return), and it has to outlive
+        // the exception handlers.
+        PGProfile::CallScope profile(fcinfo);
+        PGArenaAllocator arena;
 
-            if (result.isNull())
-                PG_RETURN_NULL();
+        try {
+            PGInterface db(fcinfo);
             
-            datum = PGToDatumConverter(fcinfo, result);
-            return datum;
+            try {
+                AnyValue result = f(db, PGValue<FunctionCallInfo>(fcinfo));
+
+                if (result.isNull())
+                    PG_RETURN_NULL();
+                
+                datum = PGToDatumConverter(fcinfo, result);
+                return datum;
+            } catch (std::exception &exc) {
+                sqlerrcode = ERRCODE_INVALID_PARAMETER_VALUE;
+                const char *error = exc.what();
+                
+                // If there is a pending error, we report this instead.
+                if (db.lastError())
+                    error = db.lastError();
+                    
+                strncpy(msg, error, sizeof(msg));
+            }
         } catch (std::exception &exc) {
             sqlerrcode = ERRCODE_INVALID_PARAMETER_VALUE;
-            const char *error = exc.what();
-            
-            // If there is a pending error, we report this instead.
-            if (db.lastError())
-                error = db.lastError();
-                
-            strncpy(msg, error, sizeof(msg));
+            strncpy(msg, exc.what(), sizeof(msg));
+        } catch (...) {
+            sqlerrcode = ERRCODE_INVALID_PARAMETER_VALUE;
+            strncpy(msg,
+                    "Unknown exception was raised.",
+                    sizeof(msg));
         }
-    } catch (std::exception &exc) {
-        sqlerrcode = ERRCODE_INVALID_PARAMETER_VALUE;
-        strncpy(msg, exc.what(), sizeof(msg));
-    } catch (...) {
-        sqlerrcode = ERRCODE_INVALID_PARAMETER_VALUE;
-        strncpy(msg,
-                "Unknown exception was raised.",
-                sizeof(msg));
     }
     
     // This code will only be reached in case of error.
     // We want to ereport only here, with only POD (plain old data) left on the
     // stack. (ereport will do a longjmp)
     msg[sizeof(msg) - 1] = '\0';
-    ereport (
-        ERROR, (
-            errcode(sqlerrcode),
-            errmsg(
-                "Function \"%s\": %s",
-                format_procedure(fcinfo->flinfo->fn_oid),
-                msg
-            )
-        )
-    );
+    raiseError(sqlerrcode, msg, fcinfo);
     
     // This will never be reached.
     PG_RETURN_NULL();
 }
 
+/**
+ * @brief Maximum number of leading arguments callInPlace() unpacks for the
+ *        in-place function
+ */
+const uint16_t kMaxNumInPlaceArgs = 8;
+
+/**
+ * @brief C++ entry point for functions that have an allocation-free fast path
+ *
+ * The in-place function receives its arguments as plain old data (no
+ * PGInterface, no AnyValue, and no memory handles are constructed). It returns
+ * true if it handled the call by modifying its first argument (usually the
+ * transition state of an aggregate) in-place. Otherwise, e.g., for the first
+ * row of an aggregate where the state still needs to be allocated, we fall back
+ * to call().
+ *
+ * Only the first \c inNumInPlaceArgs arguments are unpacked (and, for arrays,
+ * detoasted). Trailing arguments that the in-place function never reads, such
+ * as the previous state passed to iterative transition functions, are left
+ * alone.
+ */
+inline static Datum callInPlace(MADInPlaceFunction &inPlaceF, MADFunction &f,
+    uint16_t inNumInPlaceArgs, PG_FUNCTION_ARGS) {
+    
+    RawArgument args[kMaxNumInPlaceArgs];
+    uint16_t numArgs = PG_NARGS() < inNumInPlaceArgs
+        ? PG_NARGS() : inNumInPlaceArgs;
+    bool handled = false;
+    bool errorOccurred = false;
+    char msg[2048];
+
+    {
+        PGProfile::CallScope profile(fcinfo, true /* in-place */);
+
+        try {
+            if (numArgs <= kMaxNumInPlaceArgs
+                && getRawArguments(fcinfo, args, numArgs))
+                handled = inPlaceF(args, numArgs);
+        } catch (std::exception &exc) {
+            errorOccurred = true;
+            strncpy(msg, exc.what(), sizeof(msg));
+        } catch (...) {
+            errorOccurred = true;
+            strncpy(msg,
+                    "Unknown exception was raised.",
+                    sizeof(msg));
+        }
+
+        // If we fall back to call(), the call will be recorded there
+        if (!handled && !errorOccurred)
+            profile.discard();
+    }
+    
+    if (errorOccurred) {
+        // As in call(), we only ereport with POD left on the stack
+        msg[sizeof(msg) - 1] = '\0';
+        raiseError(ERRCODE_INVALID_PARAMETER_VALUE, msg, fcinfo);
+    }
+    
+    if (handled)
+        return PointerGetDatum(args[0].native);
+
+    return call(f, fcinfo);
+}
+
 } // namespace dbconnector
 
 } // namespace madlib
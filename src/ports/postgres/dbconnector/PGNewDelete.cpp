@@ -6,9 +6,9 @@
  *
  *//* ----------------------------------------------------------------------- */
 
-#include <dbconnector/PGAllocator.hpp>
+#include <dbconnector/PGArenaAllocator.hpp>
 
-using madlib::dbconnector::PGAllocator;
+using madlib::dbconnector::PGArenaAllocator;
 
 /*
  * We override global storage allocation and deallocation functions. See header
@@ -23,7 +23,13 @@ using madlib::dbconnector::PGAllocator;
  * that size.
  */
 void *operator new(std::size_t size) throw (std::bad_alloc) {
-    return PGAllocator::defaultAllocator().allocate(size);
+    PGArenaAllocator *arena = PGArenaAllocator::active();
+
+    // During a UDF call, C++ objects are allocated from the active arena
+    if (arena != NULL)
+        return arena->allocate(size);
+
+    return PGArenaAllocator::allocatePassThrough(size, true);
 }
 
 /*
@@ -42,9 +48,12 @@ void *operator new(std::size_t size) throw (std::bad_alloc) {
  *
  * The deallocation function (3.7.3.2) called by a delete-expression to render
  * the value of ptr invalid.
+ *
+ * The header in front of the memory tells who owns it (see PGArenaAllocator),
+ * so this does not depend on whether there is an active arena.
  */
 void operator delete(void *ptr) throw() {
-    PGAllocator::defaultAllocator().free(ptr);
+    PGArenaAllocator::release(ptr);
 }
 
 /**
@@ -55,12 +64,17 @@ void operator delete(void *ptr) throw() {
  * indication, instead of a bad_alloc exception.
  */
 void *operator new(std::size_t size, const std::nothrow_t &ignored) throw() {
-    return PGAllocator::defaultAllocator().allocate(size, ignored);
+    PGArenaAllocator *arena = PGArenaAllocator::active();
+
+    if (arena != NULL)
+        return arena->allocate(size, ignored);
+
+    return PGArenaAllocator::allocatePassThrough(size, false);
 }
 
 /**
  * @brief operator delete for PostgreSQL. Never throws.
  */
 void operator delete(void *ptr, const std::nothrow_t&) throw() {
-    PGAllocator::defaultAllocator().free(ptr);
+    PGArenaAllocator::release(ptr);
 }
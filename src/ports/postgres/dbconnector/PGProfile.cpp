@@ -0,0 +1,196 @@
+/* ----------------------------------------------------------------------- *//**
+ *
+ * @file PGProfile.cpp
+ *
+ * @brief Opt-in call, timing, and allocation statistics for MADlib UDFs
+ *
+ *//* ----------------------------------------------------------------------- */
+
+#include <dbconnector/PGProfile.hpp>
+
+#include <cstring>
+
+extern "C" {
+    #include <funcapi.h>
+    #include <access/htup.h>
+} // extern "C"
+
+namespace madlib {
+
+namespace dbconnector {
+
+bool PGProfile::sEnabled = false;
+uint64_t PGProfile::sNumAllocations = 0;
+uint64_t PGProfile::sNumAllocatedBytes = 0;
+uint64_t PGProfile::sNumArenaAllocations = 0;
+uint64_t PGProfile::sNumArenaAllocatedBytes = 0;
+PGProfile::Entry PGProfile::sEntries[PGProfile::kMaxFunctions];
+
+PGProfile::CallScope::CallScope(FunctionCallInfo inFCinfo, bool inInPlace)
+  : mEnabled(sEnabled && inFCinfo->flinfo != NULL),
+    mInPlace(inInPlace) {
+
+    if (!mEnabled)
+        return;
+
+    mFnOid = inFCinfo->flinfo->fn_oid;
+    mLapackSecondsAtStart = utils::LapackTimer::seconds();
+    mNumAllocationsAtStart = sNumAllocations;
+    mNumAllocatedBytesAtStart = sNumAllocatedBytes;
+    mNumArenaAllocationsAtStart = sNumArenaAllocations;
+    mNumArenaAllocatedBytesAtStart = sNumArenaAllocatedBytes;
+    mStart = utils::LapackTimer::now();
+}
+
+PGProfile::CallScope::~CallScope() {
+    // Profiling might have been disabled during the call
+    if (!mEnabled || !sEnabled)
+        return;
+
+    Entry *profile = entry(mFnOid);
+    if (profile == NULL)
+        return;
+
+    profile->numCalls++;
+    if (mInPlace)
+        profile->numInPlaceCalls++;
+    profile->seconds += utils::LapackTimer::now() - mStart;
+    profile->lapackSeconds
+        += utils::LapackTimer::seconds() - mLapackSecondsAtStart;
+    profile->numAllocations += sNumAllocations - mNumAllocationsAtStart;
+    profile->numAllocatedBytes
+        += sNumAllocatedBytes - mNumAllocatedBytesAtStart;
+    profile->numArenaAllocations
+        += sNumArenaAllocations - mNumArenaAllocationsAtStart;
+    profile->numArenaAllocatedBytes
+        += sNumArenaAllocatedBytes - mNumArenaAllocatedBytesAtStart;
+}
+
+/**
+ * @brief Remove all entries
+ */
+void PGProfile::reset() {
+    std::memset(sEntries, 0, sizeof(sEntries));
+}
+
+/**
+ * @brief Return the entry of the given function, creating it if necessary
+ *
+ * We use open addressing with linear probing. Entries are only removed all at
+ * once by reset(). If all kMaxFunctions entries are used, NULL is returned
+ * and the call is not recorded.
+ */
+PGProfile::Entry *PGProfile::entry(Oid inFnOid) {
+    for (uint32_t i = 0; i < kMaxFunctions; i++) {
+        Entry &candidate = sEntries[(inFnOid + i) % kMaxFunctions];
+
+        if (candidate.fnOid == inFnOid)
+            return &candidate;
+
+        if (candidate.fnOid == InvalidOid) {
+            candidate.fnOid = inFnOid;
+            return &candidate;
+        }
+    }
+    return NULL;
+}
+
+// The functions below are called directly by the database. They do not go
+// through call(), do not create C++ objects, and therefore may call into the
+// backend without PG_TRY().
+
+extern "C" {
+
+Datum udf_profile_enable(PG_FUNCTION_ARGS);
+PG_FUNCTION_INFO_V1(udf_profile_enable);
+
+/**
+ * @brief Enable or disable profiling in the current session
+ */
+Datum udf_profile_enable(PG_FUNCTION_ARGS) {
+    PGProfile::setEnabled(PG_GETARG_BOOL(0));
+    PG_RETURN_VOID();
+}
+
+Datum udf_profile_reset(PG_FUNCTION_ARGS);
+PG_FUNCTION_INFO_V1(udf_profile_reset);
+
+/**
+ * @brief Discard all statistics collected in the current session
+ */
+Datum udf_profile_reset(PG_FUNCTION_ARGS) {
+    PGProfile::reset();
+    PG_RETURN_VOID();
+}
+
+Datum udf_profile(PG_FUNCTION_ARGS);
+PG_FUNCTION_INFO_V1(udf_profile);
+
+/**
+ * @brief Return the statistics collected in the current session, one row per
+ *     function
+ *
+ * On the first call, we take a snapshot of all entries, so that the result is
+ * consistent even if profiled functions are called while we return rows.
+ */
+Datum udf_profile(PG_FUNCTION_ARGS) {
+    FuncCallContext *funcctx;
+    const PGProfile::Entry *entry;
+    Datum values[9];
+    bool nulls[9] = { false, false, false, false, false, false, false, false,
+        false };
+    HeapTuple tuple;
+
+    if (SRF_IS_FIRSTCALL()) {
+        MemoryContext oldContext;
+        TupleDesc tupleDesc;
+        PGProfile::Entry *snapshot;
+        uint32_t numEntries = 0;
+        uint32_t i;
+
+        funcctx = SRF_FIRSTCALL_INIT();
+        oldContext = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+        if (get_call_result_type(fcinfo, NULL, &tupleDesc)
+            != TYPEFUNC_COMPOSITE)
+            ereport(ERROR,
+                (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+                 errmsg("function returning record called in context "
+                    "that cannot accept type record")));
+        funcctx->tuple_desc = BlessTupleDesc(tupleDesc);
+
+        snapshot = static_cast<PGProfile::Entry*>(
+            palloc(PGProfile::kMaxFunctions * sizeof(PGProfile::Entry)));
+        for (i = 0; i < PGProfile::kMaxFunctions; i++)
+            if (PGProfile::entries()[i].fnOid != InvalidOid)
+                snapshot[numEntries++] = PGProfile::entries()[i];
+        funcctx->user_fctx = snapshot;
+        funcctx->max_calls = numEntries;
+
+        MemoryContextSwitchTo(oldContext);
+    }
+
+    funcctx = SRF_PERCALL_SETUP();
+    if (funcctx->call_cntr >= funcctx->max_calls)
+        SRF_RETURN_DONE(funcctx);
+
+    entry = static_cast<const PGProfile::Entry*>(funcctx->user_fctx)
+        + funcctx->call_cntr;
+    values[0] = ObjectIdGetDatum(entry->fnOid);
+    values[1] = Int64GetDatum(entry->numCalls);
+    values[2] = Int64GetDatum(entry->numInPlaceCalls);
+    values[3] = Float8GetDatum(entry->seconds);
+    values[4] = Float8GetDatum(entry->lapackSeconds);
+    values[5] = Int64GetDatum(entry->numAllocations);
+    values[6] = Int64GetDatum(entry->numAllocatedBytes);
+    values[7] = Int64GetDatum(entry->numArenaAllocations);
+    values[8] = Int64GetDatum(entry->numArenaAllocatedBytes);
+    tuple = heap_form_tuple(funcctx->tuple_desc, values, nulls);
+    SRF_RETURN_NEXT(funcctx, HeapTupleGetDatum(tuple));
+}
+
+} // extern "C"
+
+} // namespace dbconnector
+
+} // namespace madlib
@@ -0,0 +1,156 @@
+/* ----------------------------------------------------------------------- *//**
+ *
+ * @file PGProfile.hpp
+ *
+ * @brief Opt-in call, timing, and allocation statistics for MADlib UDFs
+ *
+ *//* ----------------------------------------------------------------------- */
+
+#ifndef MADLIB_POSTGRES_PGPROFILE_HPP
+#define MADLIB_POSTGRES_PGPROFILE_HPP
+
+#include <utils/LapackTimer.hpp>
+
+#include <cstddef>
+#include <stdint.h>
+
+extern "C" {
+    #include <postgres.h>
+    #include <fmgr.h>
+} // extern "C"
+
+namespace madlib {
+
+namespace dbconnector {
+
+/**
+ * @brief Per-function profile of MADlib UDF calls
+ *
+ * If enabled (with the SQL function <tt>udf_profile_enable(TRUE)</tt>), the
+ * entry points call() and callInPlace() record, for every function (keyed by
+ * \c fn_oid):
+ * - the number of calls, and how many of them were handled in-place
+ * - the cumulative wall-clock time
+ * - the number and total size of allocations through PGAllocator (i.e., calls
+ *   of \c palloc())
+ * - separately, the number and total size of allocations served from the
+ *   arena blocks of PGArenaAllocator (the blocks themselves are counted as
+ *   allocations through PGAllocator)
+ * - the cumulative wall-clock time spent in LAPACK/BLAS, as far as Armadillo
+ *   calls it through the connector's glue code (see utils::LapackTimer)
+ *
+ * The difference between total time and LAPACK time is time spent in argument
+ * conversion, memory management, and MADlib's own code. Times and allocation
+ * counts are inclusive, should a UDF ever (indirectly) call another one.
+ *
+ * The statistics are kept in static memory of the backend process. Hence, they
+ * are per session (and, on Greenplum, per segment), and they are read and
+ * reset with the SQL functions <tt>udf_profile()</tt> and
+ * <tt>udf_profile_reset()</tt> in the same session. If disabled (the default),
+ * the only cost is testing a static flag.
+ *
+ * @internal Everything in here is plain old data, and nothing may call into
+ *     the backend (except for the SQL functions in PGProfile.cpp, which do not
+ *     have any C++ objects on the stack).
+ */
+class PGProfile {
+public:
+    enum { kMaxFunctions = 256 };
+
+    /**
+     * @brief Statistics of a single function
+     */
+    struct Entry {
+        Oid fnOid;
+        uint64_t numCalls;
+        uint64_t numInPlaceCalls;
+        uint64_t numAllocations;
+        uint64_t numAllocatedBytes;
+        uint64_t numArenaAllocations;
+        uint64_t numArenaAllocatedBytes;
+        double seconds;
+        double lapackSeconds;
+    };
+
+    /**
+     * @brief Profile a call of a UDF from construction to destruction
+     *
+     * The scope must be destroyed before an error is raised with ereport().
+     */
+    class CallScope {
+    public:
+        CallScope(FunctionCallInfo inFCinfo, bool inInPlace = false);
+        ~CallScope();
+
+        /**
+         * @brief Do not record this call, e.g., because it will be recorded
+         *     by another scope
+         */
+        void discard() {
+            mEnabled = false;
+        }
+
+    private:
+        bool mEnabled;
+        bool mInPlace;
+        Oid mFnOid;
+        double mStart;
+        double mLapackSecondsAtStart;
+        uint64_t mNumAllocationsAtStart;
+        uint64_t mNumAllocatedBytesAtStart;
+        uint64_t mNumArenaAllocationsAtStart;
+        uint64_t mNumArenaAllocatedBytesAtStart;
+    };
+
+    static bool isEnabled() {
+        return sEnabled;
+    }
+
+    static void setEnabled(bool inEnabled) {
+        sEnabled = inEnabled;
+        utils::LapackTimer::enabled() = inEnabled;
+    }
+
+    /**
+     * @brief Record an allocation (called by PGAllocator)
+     */
+    static void countAllocation(uint32_t inSize) {
+        if (sEnabled) {
+            sNumAllocations++;
+            sNumAllocatedBytes += inSize;
+        }
+    }
+
+    /**
+     * @brief Record an allocation from an arena block (called by
+     *     PGArenaAllocator)
+     */
+    static void countArenaAllocation(std::size_t inSize) {
+        if (sEnabled) {
+            sNumArenaAllocations++;
+            sNumArenaAllocatedBytes += inSize;
+        }
+    }
+
+    static void reset();
+
+    static const Entry *entries() {
+        return sEntries;
+    }
+
+private:
+    static Entry *entry(Oid inFnOid);
+
+    static bool sEnabled;
+    static uint64_t sNumAllocations;
+    static uint64_t sNumAllocatedBytes;
+    static uint64_t sNumArenaAllocations;
+    static uint64_t sNumArenaAllocatedBytes;
+    static Entry sEntries[kMaxFunctions];
+};
+
+} // namespace dbconnector
+
+} // namespace madlib
+
+#endif
@@ -13,8 +13,6 @@ extern "C" {
     #include <utils/array.h>
     #include <catalog/pg_type.h>
     #include <funcapi.h>
-    #include <utils/lsyscache.h>
-    #include <utils/typcache.h>
 }
 
 
@@ -30,26 +28,16 @@ namespace dbconnector {
  */
 PGToDatumConverter::PGToDatumConverter(const FunctionCallInfo inFCInfo,
     const AbstractValue &inValue)
-    : ValueConverter<Datum>(inValue), mTupleDesc(NULL), mTypeID(0) {
+    : ValueConverter<Datum>(inValue), mTypeInfo(NULL) {
     
-    bool exceptionOccurred = false;
-    TypeFuncClass funcClass;
-    
-    PG_TRY(); {
-        // FIXME: (Or Note:) get_call_result_type is tagged as expensive in funcapi.c
-        funcClass = get_call_result_type(inFCInfo, &mTypeID, &mTupleDesc);
-    } PG_CATCH(); {
-        exceptionOccurred = true;
-    } PG_END_TRY();
-    
-    BOOST_ASSERT_MSG(exceptionOccurred == false, "An exception occurred while "
-        "converting a DBAL object to a PostgreSQL datum.");
+    PGFunctionCache *cache = PGFunctionCache::get(inFCInfo);
+    mTypeInfo = &cache->result(inFCInfo);
     
-    if (!mValue.isCompound() && funcClass == TYPEFUNC_COMPOSITE)
+    if (!mValue.isCompound() && cache->resultClass == TYPEFUNC_COMPOSITE)
         throw std::logic_error("Internal function does not provide compound "
             "type expected by SQL function");
     
-    if (mValue.isCompound() && funcClass != TYPEFUNC_COMPOSITE)
+    if (mValue.isCompound() && cache->resultClass != TYPEFUNC_COMPOSITE)
         throw std::logic_error("SQL function or context does not accept "
             "compound type");
 }
@@ -58,32 +46,15 @@ PGToDatumConverter::PGToDatumConverter(const FunctionCallInfo inFCInfo,
  * @brief Constructor: Initialize conversion of some child element of function
  *        return value
  *
- * @see PGInterface for information on necessary precautions when writing
- *      PostgreSQL plug-in code in C++.
+ * @param inTypeInfo Type information of the child element, as cached in the
+ *     PGFunctionCache of the call site
+ * @param inValue The child element
  */
-PGToDatumConverter::PGToDatumConverter(Oid inTypeID,
+PGToDatumConverter::PGToDatumConverter(const PGTypeInfo &inTypeInfo,
     const AbstractValue &inValue)
-    : ValueConverter<Datum>(inValue), mTupleDesc(NULL), mTypeID(inTypeID) {
+    : ValueConverter<Datum>(inValue), mTypeInfo(&inTypeInfo) {
     
-    bool exceptionOccurred = false;
-    bool isTuple;
-    
-    PG_TRY(); {
-        isTuple = type_is_rowtype(inTypeID);
-        
-        if (isTuple) {
-            // Don't ereport errors. We set typmod < 0, and this should not cause
-            // an error because compound types in another compund can never be
-            // transient. (I think)
-
-            mTupleDesc = lookup_rowtype_tupdesc_noerror(inTypeID, -1, true);
-        }
-    } PG_CATCH(); {
-        exceptionOccurred = true;
-    } PG_END_TRY();
-
-    BOOST_ASSERT_MSG(exceptionOccurred == false, "An exception occurred while "
-        "converting a DBAL object to a PostgreSQL datum.");
+    bool isTuple = mTypeInfo->tupleDesc != NULL;
     
     if (isTuple && !mValue.isCompound())
         throw std::logic_error("Internal function does not return "
@@ -104,18 +75,19 @@ void PGToDatumConverter::convert(const AnyValueVector &inRecord) {
         throw std::logic_error("Internal MADlib error, got internal compound "
             "type where not expected");
 
-    if (size_t(mTupleDesc->natts) != inRecord.size())
+    TupleDesc tupleDesc = mTypeInfo->tupleDesc;
+    if (size_t(tupleDesc->natts) != inRecord.size())
         throw std::logic_error("Number of elements in record expected by SQL "
             "function does not match number of elements provided internally");
     
     shared_ptr<Datum> resultDatum(
-        new Datum[mTupleDesc->natts], ArrayDeleter<Datum>());
+        new Datum[tupleDesc->natts], ArrayDeleter<Datum>());
     shared_ptr<bool> resultDatumIsNull(
-        new bool[mTupleDesc->natts], ArrayDeleter<bool>());
+        new bool[tupleDesc->natts], ArrayDeleter<bool>());
 
-    for (int i = 0; i < mTupleDesc->natts; i++) {
+    for (int i = 0; i < tupleDesc->natts; i++) {
         resultDatum.get()[i] = PGToDatumConverter(
-            mTupleDesc->attrs[i]->atttypid, inRecord[i]);
+            mTypeInfo->attributes[i], inRecord[i]);
         resultDatumIsNull.get()[i] = inRecord[i].isNull();
     }
     
@@ -123,7 +95,7 @@ void PGToDatumConverter::convert(const AnyValueVector &inRecord) {
     HeapTuple heapTuple;
     
     PG_TRY(); {
-        heapTuple = heap_form_tuple(mTupleDesc, resultDatum.get(),
+        heapTuple = heap_form_tuple(tupleDesc, resultDatum.get(),
             resultDatumIsNull.get());
         
         mConvertedValue = HeapTupleGetDatum(heapTuple);
@@ -148,7 +120,7 @@ void PGToDatumConverter::convert(const double &inValue) {
     bool conversionErrorOccurred = false;
 
     PG_TRY(); {
-        switch (mTypeID) {
+        switch (mTypeInfo->typeID) {
             case FLOAT8OID: mConvertedValue = Float8GetDatum(inValue); break;
             default: conversionErrorOccurred = true;
         }
@@ -177,7 +149,7 @@ void PGToDatumConverter::convert(const float &inValue) {
     bool conversionErrorOccurred = false;
 
     PG_TRY(); {
-        switch (mTypeID) {
+        switch (mTypeInfo->typeID) {
             case FLOAT8OID: mConvertedValue = Float8GetDatum(inValue); break;
             case FLOAT4OID: mConvertedValue = Float4GetDatum(inValue); break;
             default: conversionErrorOccurred = true;
@@ -211,7 +183,7 @@ void PGToDatumConverter::convert(const int32_t &inValue) {
     bool conversionErrorOccurred = false;
 
     PG_TRY(); {
-        switch (mTypeID) {
+        switch (mTypeInfo->typeID) {
             case INT8OID: mConvertedValue = Int64GetDatum(inValue); break;
             case INT4OID: mConvertedValue = Int32GetDatum(inValue); break;
             case FLOAT8OID: mConvertedValue = Float8GetDatum(inValue); break;
@@ -238,21 +210,11 @@ void PGToDatumConverter::convert(const int32_t &inValue) {
  *      PostgreSQL plug-in code in C++.
  */
 void PGToDatumConverter::convertArray(const MemHandleSPtr &inHandle,
-    uint32_t inNumElements) {
+    const double *inData, uint32_t inNumElements) {
 
     bool exceptionOccurred = false;
-    Oid elementTypeID;
-
-    PG_TRY(); {
-        elementTypeID = get_element_type(mTypeID);
-    } PG_CATCH(); {
-        exceptionOccurred = true;
-    } PG_END_TRY();
-
-    BOOST_ASSERT_MSG(exceptionOccurred == false, "An exception occurred while "
-        "converting a DBAL object to a PostgreSQL datum.");
 
-    switch (elementTypeID) {
+    switch (mTypeInfo->elementTypeID) {
         case FLOAT8OID: {
             shared_ptr<PGArrayHandle> arrayHandle
                 = dynamic_pointer_cast<PGArrayHandle>(inHandle);
@@ -262,12 +224,14 @@ void PGToDatumConverter::convertArray(const MemHandleSPtr &inHandle,
                     mConvertedValue = PointerGetDatum(arrayHandle->array());
                 } else {
                     // If the Array does not use a PostgreSQL array
-                    // as its storage, we have to create a new PostgreSQL array
-                    // and copy the values.
+                    // as its storage (or is not backed by a memory handle at
+                    // all), we have to create a new PostgreSQL array and copy
+                    // the values.
                     mConvertedValue =
                         PointerGetDatum(
                             construct_array(
-                                static_cast<Datum*>(inHandle->ptr()),
+                                reinterpret_cast<Datum*>(
+                                    const_cast<double*>(inData)),
                                 inNumElements,
                                 FLOAT8OID, sizeof(double), true, 'd'
                             )
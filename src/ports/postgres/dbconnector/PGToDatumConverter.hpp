@@ -11,11 +11,11 @@
 #define MADLIB_POSTGRES_PGTODATUMCONVERTER_HPP
 
 #include <dbconnector/PGCommon.hpp>
+#include <dbconnector/PGFunctionCache.hpp>
 
 extern "C" {
     #include <postgres.h>
     #include <fmgr.h>
-    #include <access/tupdesc.h> // TupleDesc
 } // extern "C"
 
 
@@ -26,39 +26,39 @@ namespace dbconnector {
 /**
  * @brief Convert DBAL types into PostgreSQL Datum
  *
- * @internal This class makes frequent calls into the PostgreSQL backend. 
+ * @internal All type information (including tuple descriptors) is taken from
+ *     the PGFunctionCache of the call site, so the backend is only asked once
+ *     per call site.
  */
 class PGToDatumConverter : public ValueConverter<Datum> {
 public:
     PGToDatumConverter(const FunctionCallInfo inFCInfo,
         const AbstractValue &inValue);
     
-    PGToDatumConverter(Oid inTypeID, const AbstractValue &inValue);
-    
-    ~PGToDatumConverter() {
-        if (mTupleDesc != NULL)
-            ReleaseTupleDesc(mTupleDesc);
-    }
+    PGToDatumConverter(const PGTypeInfo &inTypeInfo,
+        const AbstractValue &inValue);
     
     void convert(const double &inValue);
     void convert(const float &inValue);
     void convert(const int32_t &inValue);
     
     void convert(const Array<double> &inValue) {
-        convertArray(inValue.memoryHandle(), inValue.num_elements());
+        convertArray(inValue.memoryHandle(), inValue.data(),
+            inValue.num_elements());
     }
     
     void convert(const DoubleCol &inValue) {
-        convertArray(inValue.memoryHandle(), inValue.n_elem);
+        convertArray(inValue.memoryHandle(), inValue.memptr(),
+            inValue.n_elem);
     }
     
     void convert(const AnyValueVector &inRecord);
     
 protected:
-    TupleDesc mTupleDesc;
-    Oid mTypeID;
+    const PGTypeInfo *mTypeInfo;
     
-    void convertArray(const MemHandleSPtr &inHandle, uint32_t inNumElements);
+    void convertArray(const MemHandleSPtr &inHandle, const double *inData,
+        uint32_t inNumElements);
 };
 
 } // namespace dbconnector
@@ -12,6 +12,8 @@
 #include <stdexcept>
 
 extern "C" {
+    #include <catalog/pg_type.h>
+    #include <utils/array.h>
     #include <utils/typcache.h>
     #include <executor/executor.h>
 }
@@ -36,31 +38,13 @@ AbstractValueSPtr PGValue<FunctionCallInfo>::getValueByID(unsigned int inID) con
     if (PG_ARGISNULL(inID))
         return AbstractValueSPtr(new AnyValue(Null()));
     
-    bool exceptionOccurred = false;
-    Oid typeID;
-    bool writable;
-    
-    PG_TRY(); {
-        typeID = get_fn_expr_argtype(fcinfo->flinfo, inID);
-
-        // If we are called as an aggregate function, the first argument is the
-        // transition state. In that case, we are free to modify the data.
-        // In fact, for performance reasons, we *should* even do all modifications
-        // in-place. In all other cases, directly modifying memory is dangerous.
-        // See warning at:
-        // http://www.postgresql.org/docs/current/static/xfunc-c.html#XFUNC-C-BASETYPE
-        writable = (inID == 0 && AggCheckCallContext(fcinfo, NULL));
-    } PG_CATCH(); {
-        exceptionOccurred = true;
-    } PG_END_TRY();
+    const PGArgumentInfo &argInfo
+        = PGFunctionCache::get(fcinfo)->argument(inID);
     
-    BOOST_ASSERT_MSG(exceptionOccurred == false, "An exception occurred while "
-        "gathering inormation about PostgreSQL function arguments");
-    
-    if (typeID == InvalidOid)
+    if (argInfo.typeID == InvalidOid)
         throw std::invalid_argument("Cannot determine function argument type");
 
-    AbstractValueSPtr value = DatumToValue(writable, typeID, PG_GETARG_DATUM(inID));
+    AbstractValueSPtr value = DatumToValue(argInfo, PG_GETARG_DATUM(inID));
     if (!value)
         throw std::invalid_argument(
             "Internal argument type does not match SQL argument type");
@@ -112,6 +96,103 @@ AbstractValueSPtr PGValue<HeapTupleHeader>::getValueByID(unsigned int inID) cons
     return value;
 }
 
+/**
+ * @brief Describe the leading function arguments as plain old data, without
+ *        allocating memory
+ *
+ * Only scalar types and one-dimensional DOUBLE PRECISION arrays without NULLs
+ * are supported. The result is undefined if false is returned.
+ *
+ * @param fcinfo The function-call information
+ * @param outArgs Array of at least \c inNumArgs elements
+ * @param inNumArgs Number of leading arguments to unpack. Must not exceed
+ *     the number of arguments passed. Later arguments are not looked at.
+ * @return Whether these arguments could be represented. If not, the caller is
+ *     supposed to use the generic code path (PGValue<FunctionCallInfo>), which
+ *     will also provide appropriate error messages.
+ *
+ * @note Arrays stored in compressed or short-header format still need to be
+ *     detoasted (i.e., copied) by PostgreSQL.
+ *
+ * @see PGInterface for information on necessary precautions when writing
+ *      PostgreSQL plug-in code in C++.
+ */
+bool getRawArguments(const FunctionCallInfo fcinfo, RawArgument *outArgs,
+    uint16_t inNumArgs) {
+    
+    BOOST_ASSERT(inNumArgs <= PG_NARGS());
+
+    const PGFunctionCache *cache = PGFunctionCache::get(fcinfo);
+    bool exceptionOccurred = false;
+    bool supported = true;
+    ArrayType *array;
+    int i;
+
+    PG_TRY(); {
+        for (i = 0; supported && i < inNumArgs; i++) {
+            outArgs[i].isMutable = cache->args[i].writable;
+            outArgs[i].data = NULL;
+            outArgs[i].numElements = 0;
+            outArgs[i].native = NULL;
+
+            if (PG_ARGISNULL(i)) {
+                outArgs[i].type = RawArgument::kNull;
+            } else if (cache->args[i].elementTypeID == FLOAT8OID) {
+                array = PG_GETARG_ARRAYTYPE_P(i);
+                if (ARR_NDIM(array) != 1 || ARR_HASNULL(array)) {
+                    supported = false;
+                } else {
+                    outArgs[i].type = RawArgument::kDoubleArray;
+                    outArgs[i].data = reinterpret_cast<double*>(
+                        ARR_DATA_PTR(array));
+                    outArgs[i].numElements = ARR_DIMS(array)[0];
+                    outArgs[i].native = array;
+                }
+            } else if (cache->args[i].isTuple
+                || cache->args[i].elementTypeID != InvalidOid) {
+                
+                supported = false;
+            } else {
+                switch (cache->args[i].typeID) {
+                    case BOOLOID:
+                        outArgs[i].type = RawArgument::kBool;
+                        outArgs[i].value.boolValue = PG_GETARG_BOOL(i);
+                        break;
+                    case INT2OID:
+                        outArgs[i].type = RawArgument::kInt16;
+                        outArgs[i].value.int16Value = PG_GETARG_INT16(i);
+                        break;
+                    case INT4OID:
+                        outArgs[i].type = RawArgument::kInt32;
+                        outArgs[i].value.int32Value = PG_GETARG_INT32(i);
+                        break;
+                    case INT8OID:
+                        outArgs[i].type = RawArgument::kInt64;
+                        outArgs[i].value.int64Value = PG_GETARG_INT64(i);
+                        break;
+                    case FLOAT4OID:
+                        outArgs[i].type = RawArgument::kFloat;
+                        outArgs[i].value.floatValue = PG_GETARG_FLOAT4(i);
+                        break;
+                    case FLOAT8OID:
+                        outArgs[i].type = RawArgument::kDouble;
+                        outArgs[i].value.doubleValue = PG_GETARG_FLOAT8(i);
+                        break;
+                    default:
+                        supported = false;
+                }
+            }
+        }
+    } PG_CATCH(); {
+        exceptionOccurred = true;
+    } PG_END_TRY();
+
+    BOOST_ASSERT_MSG(exceptionOccurred == false, "An exception occurred while "
+        "gathering inormation about PostgreSQL function arguments");
+    
+    return supported;
+}
+
 } // namespace dbconnector
 
 } // namespace madlib
@@ -28,6 +28,9 @@ using dbal::AbstractValueSPtr;
 template <typename T>
 class PGValue;
 
+bool getRawArguments(const FunctionCallInfo fcinfo, RawArgument *outArgs,
+    uint16_t inNumArgs);
+
 /**
  * @brief PostgreSQL function-argument value class
  *
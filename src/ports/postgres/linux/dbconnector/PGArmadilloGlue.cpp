@@ -11,6 +11,8 @@
 
 #include <armadillo>
 
+#include <utils/LapackTimer.hpp>
+
 namespace madlib {
 
 namespace dbconnector {
@@ -47,7 +49,7 @@ extern "C" {
 
 #define arma_fortran(function) madlib_##function
 
-#define MADLIB_FORTRAN_DECLARE(x) { x; }
+#define MADLIB_FORTRAN_DECLARE(x) { utils::LapackTimer timer; x; }
 
 #define MADLIB_FORTRAN(function) arma_fortran2(function)
 
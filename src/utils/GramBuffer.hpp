@@ -0,0 +1,184 @@
+/* ----------------------------------------------------------------------- *//**
+ *
+ * @file GramBuffer.hpp
+ *
+ * @brief Blocked accumulation of Gram matrices inside transition states
+ *
+ *//* ----------------------------------------------------------------------- */
+
+#ifndef MADLIB_GRAMBUFFER_HPP
+#define MADLIB_GRAMBUFFER_HPP
+
+#include <utils/Reference.hpp>
+#include <utils/packedSymmetric.hpp>
+
+#include <algorithm>
+
+namespace madlib {
+
+namespace utils {
+
+/**
+ * @brief Buffer for rows that are still to be added to a Gram matrix
+ *        \f$ X^T X \f$
+ *
+ * The Gram matrix is symmetric and kept in packed storage (see
+ * packedSymmetric.hpp). Adding one row at a time to it is a rank-1 update
+ * (BLAS level 2) per row. For wide designs, it is much more cache-friendly to
+ * collect a block of rows and add all of them with matrix-matrix products
+ * (BLAS level 3). GramBuffer is a view on memory inside an aggregate
+ * transition state, so that buffered rows survive between calls of the
+ * transition function.
+ *
+ * The buffer is part of the transition state, so it is copied whenever the
+ * state is (e.g., when Greenplum ships states from the segments to the
+ * master). It takes kBlockSize * width doubles, while the packed Gram matrix
+ * takes width * (width + 1) / 2. Buffering is therefore only used from
+ * kMinWidth on, where the buffer is at most half the size of the Gram matrix.
+ * For narrower designs, blockSize() is 0, no memory is used, and isEnabled()
+ * returns false.
+ *
+ * @internal Memory layout (only if blockSize(width) > 0):
+ * - 0: numRows (number of buffered rows)
+ * - 1: rows (width x blockSize matrix, each column is one buffered row)
+ */
+class GramBuffer {
+public:
+    enum {
+        kBlockSize = 64,
+        kMinWidth = 4 * kBlockSize - 1
+    };
+
+    /**
+     * @brief Number of rows that are buffered before a flush
+     */
+    static inline uint32_t blockSize(const uint32_t inWidth) {
+        return inWidth < kMinWidth ? 0 : kBlockSize;
+    }
+
+    /**
+     * @brief Number of doubles needed in the transition state
+     */
+    static inline uint32_t arraySize(const uint32_t inWidth) {
+        return blockSize(inWidth) == 0 ? 0 : 1 + blockSize(inWidth) * inWidth;
+    }
+
+    GramBuffer() : mBlockSize(0) { }
+
+    /**
+     * @brief Rebind to the given memory, which must hold at least
+     *        arraySize(inWidth) doubles
+     */
+    inline void rebind(double *inPtr, const uint16_t inWidth) {
+        mBlockSize = blockSize(inWidth);
+        if (mBlockSize == 0)
+            return;
+
+        mNumRows.rebind(inPtr);
+        mRows.rebind(inPtr + 1, inWidth, mBlockSize);
+    }
+
+    /**
+     * @brief Do not buffer rows (e.g., because there is no memory for the
+     *        buffer), so that push() must not be called
+     */
+    inline void disable() {
+        mBlockSize = 0;
+    }
+
+    inline bool isEnabled() const {
+        return mBlockSize > 0;
+    }
+
+    /**
+     * @brief Buffer the row <tt>inScale * inX</tt>, and flush if the buffer is
+     *        full
+     *
+     * For a weighted Gram matrix \f$ X^T A X \f$, pass \f$ \sqrt{a_i} \f$ as
+     * scale factor.
+     */
+    inline void push(const double *inX, const double inScale,
+        double *ioGramAP) {
+
+        double *row = mRows.colptr(mNumRows);
+        for (uint32_t i = 0; i < mRows.n_rows; i++)
+            row[i] = inScale * inX[i];
+
+        if (++mNumRows == mBlockSize)
+            flush(ioGramAP);
+    }
+
+    /**
+     * @brief Add the buffered rows to a packed Gram matrix, but keep the buffer
+     *
+     * This is for buffers of immutable states (e.g., the right-hand side when
+     * merging states). The upper triangle is computed in tiles of at most
+     * kBlockSize x kBlockSize elements, each of which is a single call of
+     * dgemm. Hence, only about half of the full product is computed. The
+     * tiles are computed into a fixed buffer on the stack, so that flushing
+     * does not allocate memory.
+     */
+    inline void addTo(double *ioGramAP) const {
+        if (!isEnabled() || mNumRows == 0)
+            return;
+
+        double tile[kBlockSize * kBlockSize];
+        const double one = 1;
+        const double zero = 0;
+        const uint32_t width = mRows.n_rows;
+        const double *rows = mRows.memptr();
+        const arma::blas_int ldRows = width;
+        const arma::blas_int numRows = mNumRows;
+
+        for (uint32_t first = 0; first < width; first += kBlockSize) {
+            uint32_t last = std::min<uint32_t>(first + kBlockSize, width) - 1;
+            const arma::blas_int numCols = last - first + 1;
+
+            // Since first is a multiple of kBlockSize, the row tiles above
+            // the diagonal end exactly at row first - 1
+            for (uint32_t rowFirst = 0; rowFirst <= last;
+                rowFirst += kBlockSize) {
+
+                uint32_t rowLast
+                    = std::min<uint32_t>(rowFirst + kBlockSize, last + 1) - 1;
+                const arma::blas_int numTileRows = rowLast - rowFirst + 1;
+
+                // Rows rowFirst, ..., rowLast of columns first, ..., last
+                arma::blas::gemm<double>("N", "T", &numTileRows, &numCols,
+                    &numRows, &one, rows + rowFirst, &ldRows, rows + first,
+                    &ldRows, &zero, tile, &numTileRows);
+                for (uint32_t j = first; j <= last; j++) {
+                    double *column = ioGramAP + packedColumnOffset(j);
+                    const double *tileColumn
+                        = tile + (j - first) * numTileRows - rowFirst;
+                    for (uint32_t i = rowFirst; i <= std::min(j, rowLast); i++)
+                        column[i] += tileColumn[i];
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Add the buffered rows to a packed Gram matrix and empty the buffer
+     */
+    inline void flush(double *ioGramAP) {
+        addTo(ioGramAP);
+        clear();
+    }
+
+    inline void clear() {
+        if (isEnabled())
+            mNumRows = 0;
+    }
+
+private:
+    uint32_t mBlockSize;
+    Reference<double, uint32_t> mNumRows;
+    dbal::DoubleMat mRows;
+};
+
+} // namespace utils
+
+} // namespace madlib
+
+#endif
@@ -0,0 +1,76 @@
+/* ----------------------------------------------------------------------- *//**
+ *
+ * @file LapackTimer.hpp
+ *
+ * @brief Cumulative wall-clock time spent in LAPACK/BLAS routines
+ *
+ *//* ----------------------------------------------------------------------- */
+
+#ifndef MADLIB_LAPACKTIMER_HPP
+#define MADLIB_LAPACKTIMER_HPP
+
+#include <cstddef>
+#include <sys/time.h>
+
+namespace madlib {
+
+namespace utils {
+
+/**
+ * @brief Measure the time of a LAPACK/BLAS call from construction to
+ *        destruction, if enabled
+ *
+ * The glue code through which Armadillo calls LAPACK and BLAS creates a
+ * LapackTimer for every call. The glue code is shared by the connector
+ * libraries and the micro-benchmarks, so this class is header-only and does
+ * not depend on any DBMS. The counters are function-local statics of inline
+ * functions, so there is only one instance per shared library.
+ */
+class LapackTimer {
+public:
+    LapackTimer() : mEnabled(enabled()) {
+        if (mEnabled)
+            mStart = now();
+    }
+
+    ~LapackTimer() {
+        if (mEnabled)
+            seconds() += now() - mStart;
+    }
+
+    /**
+     * @brief Whether calls are timed (default: false)
+     */
+    static bool &enabled() {
+        static bool sEnabled = false;
+        return sEnabled;
+    }
+
+    /**
+     * @brief Cumulative time of all timed calls
+     */
+    static double &seconds() {
+        static double sSeconds = 0;
+        return sSeconds;
+    }
+
+    /**
+     * @brief Return the current wall-clock time in seconds
+     */
+    static double now() {
+        struct timeval time;
+
+        gettimeofday(&time, NULL);
+        return time.tv_sec + time.tv_usec * 1e-6;
+    }
+
+private:
+    bool mEnabled;
+    double mStart;
+};
+
+} // namespace utils
+
+} // namespace madlib
+
+#endif
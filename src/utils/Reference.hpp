@@ -22,6 +22,8 @@ namespace utils {
 template <typename T, typename U = T>
 class Reference {
 public:
+    Reference() : mPtr(NULL) { }
+
     Reference(T *inPtr) {
         mPtr = inPtr;
     }
@@ -0,0 +1,111 @@
+/* ----------------------------------------------------------------------- *//**
+ *
+ * @file SymmetricPositiveDecomposition.hpp
+ *
+ * @brief Decomposition of symmetric positive semi-definite matrices
+ *
+ *//* ----------------------------------------------------------------------- */
+
+#ifndef MADLIB_SYMMETRICPOSITIVEDECOMPOSITION_HPP
+#define MADLIB_SYMMETRICPOSITIVEDECOMPOSITION_HPP
+
+#include <limits>
+
+namespace madlib {
+
+namespace utils {
+
+/**
+ * @brief Condition number, pseudo-inverse, and least-squares solutions for a
+ *        symmetric positive semi-definite matrix, all from a single
+ *        decomposition
+ *
+ * For a symmetric positive semi-definite matrix \f$ A \f$, the singular value
+ * decomposition coincides with the eigen decomposition
+ * \f$ A = V \Lambda V^T \f$. We therefore need only one call into LAPACK
+ * (<tt>dsyev</tt> via <tt>eig_sym()</tt>), which is also cheaper than an SVD.
+ * Before, callers used <tt>svd()</tt> for the condition number and then
+ * <tt>pinv()</tt>, which computes another SVD internally.
+ *
+ * Eigenvalues with absolute value not greater than
+ * \f$ n \cdot \max_i |\lambda_i| \cdot \epsilon \f$ are treated as 0. This is
+ * the same tolerance that <tt>pinv()</tt> uses by default. Eigenvalues that
+ * are slightly negative due to rounding are handled as in the SVD, where
+ * the singular values are \f$ |\lambda_i| \f$.
+ */
+class SymmetricPositiveDecomposition {
+public:
+    SymmetricPositiveDecomposition(const arma::mat &inMatrix) {
+        arma::eig_sym(mEigenvalues, mEigenvectors, inMatrix);
+        mTolerance = inMatrix.n_rows * arma::max(arma::abs(mEigenvalues))
+            * std::numeric_limits<double>::epsilon();
+    }
+
+    /**
+     * @brief Return the condition number (w.r.t. the 2-norm)
+     *
+     * This is infinity if the matrix is singular.
+     */
+    double conditionNo() const {
+        arma::colvec singularValues = arma::abs(mEigenvalues);
+        return arma::max(singularValues) / arma::min(singularValues);
+    }
+
+    /**
+     * @brief Return the diagonal of the pseudo-inverse \f$ A^+ \f$
+     *
+     * The diagonal is \f$ (A^+)_{ii} = \sum_k v_{ik}^2 / \lambda_k \f$, so we
+     * do not have to form the pseudo-inverse explicitly.
+     */
+    arma::colvec pseudoInverseDiagonal() const {
+        arma::colvec diagonal(mEigenvalues.n_elem);
+        diagonal.zeros();
+        for (uint32_t k = 0; k < mEigenvalues.n_elem; k++) {
+            if (!isNonZero(k))
+                continue;
+
+            const double *v = mEigenvectors.colptr(k);
+            for (uint32_t i = 0; i < diagonal.n_elem; i++)
+                diagonal(i) += v[i] * v[i] / mEigenvalues(k);
+        }
+        return diagonal;
+    }
+
+    /**
+     * @brief Return the pseudo-inverse \f$ A^+ \f$
+     */
+    arma::mat pseudoInverse() const {
+        arma::mat scaledEigenvectors = mEigenvectors;
+        for (uint32_t k = 0; k < mEigenvalues.n_elem; k++)
+            scaledEigenvectors.col(k) *= isNonZero(k)
+                ? 1. / mEigenvalues(k) : 0.;
+        return scaledEigenvectors * arma::trans(mEigenvectors);
+    }
+
+    /**
+     * @brief Return \f$ A^+ b \f$, the minimum-norm least-squares solution of
+     *        \f$ A x = b \f$
+     */
+    arma::colvec solve(const arma::colvec &inB) const {
+        arma::colvec coordinates = arma::trans(mEigenvectors) * inB;
+        for (uint32_t k = 0; k < mEigenvalues.n_elem; k++)
+            coordinates(k) = isNonZero(k) ? coordinates(k) / mEigenvalues(k)
+                : 0.;
+        return mEigenvectors * coordinates;
+    }
+
+private:
+    bool isNonZero(uint32_t inK) const {
+        return std::fabs(mEigenvalues(inK)) > mTolerance;
+    }
+
+    arma::colvec mEigenvalues;
+    arma::mat mEigenvectors;
+    double mTolerance;
+};
+
+} // namespace utils
+
+} // namespace madlib
+
+#endif
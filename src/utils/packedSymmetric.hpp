@@ -0,0 +1,124 @@
+/* ----------------------------------------------------------------------- *//**
+ *
+ * @file packedSymmetric.hpp
+ *
+ * @brief Symmetric matrices stored as packed upper triangles
+ *
+ * A symmetric \f$ n \times n \f$ matrix \f$ A \f$ is fully determined by its
+ * upper triangle. In packed storage (as in LAPACK with <tt>uplo = 'U'</tt>),
+ * the upper triangle is stored column by column, i.e., \f$ a_{ij} \f$ with
+ * \f$ i \leq j \f$ is at position \f$ i + j(j+1)/2 \f$. This needs only
+ * \f$ n(n+1)/2 \f$ instead of \f$ n^2 \f$ elements.
+ *
+ *//* ----------------------------------------------------------------------- */
+
+#ifndef MADLIB_PACKEDSYMMETRIC_HPP
+#define MADLIB_PACKEDSYMMETRIC_HPP
+
+#if defined(__AVX__)
+    #include <immintrin.h>
+#elif defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
+namespace madlib {
+
+namespace utils {
+
+/**
+ * @brief Number of elements of a packed symmetric \f$ n \times n \f$ matrix
+ */
+inline uint32_t packedSize(uint32_t inN) {
+    return inN * (inN + 1) / 2;
+}
+
+/**
+ * @brief Offset of the first element of column \f$ j \f$ in packed storage
+ */
+inline std::size_t packedColumnOffset(uint32_t inJ) {
+    return static_cast<std::size_t>(inJ) * (inJ + 1) / 2;
+}
+
+/**
+ * @brief Compute \f$ A \leftarrow A + \alpha x x^T \f$ for a packed symmetric
+ *        matrix \f$ A \f$
+ *
+ * The upper part of column \f$ j \f$ is contiguous in memory, so the update
+ * consists of \f$ n \f$ axpy operations of increasing length. We vectorize
+ * them with AVX or SSE2 (whichever the compiler targets) and fall back to
+ * scalar code otherwise. Memory need not be aligned. Compared to the dense
+ * outer product, this halves the number of floating-point operations and the
+ * memory traffic.
+ *
+ * @param inN Number of rows (and columns) of \f$ A \f$ and length of \f$ x \f$
+ * @param inAlpha Scalar factor \f$ \alpha \f$
+ * @param inX The vector \f$ x \f$
+ * @param ioAP The matrix \f$ A \f$ in packed storage
+ */
+inline void symmetricRankOneUpdate(uint32_t inN, double inAlpha,
+    const double *inX, double *ioAP) {
+
+    for (uint32_t j = 0; j < inN; j++) {
+        const double factor = inAlpha * inX[j];
+        double *column = ioAP + packedColumnOffset(j);
+        uint32_t i = 0;
+
+#if defined(__AVX__)
+        const __m256d factor4 = _mm256_set1_pd(factor);
+        for (; i + 3 <= j; i += 4)
+            _mm256_storeu_pd(column + i,
+                _mm256_add_pd(
+                    _mm256_loadu_pd(column + i),
+                    _mm256_mul_pd(factor4, _mm256_loadu_pd(inX + i))));
+#endif
+#if defined(__SSE2__)
+        const __m128d factor2 = _mm_set1_pd(factor);
+        for (; i + 1 <= j; i += 2)
+            _mm_storeu_pd(column + i,
+                _mm_add_pd(
+                    _mm_loadu_pd(column + i),
+                    _mm_mul_pd(factor2, _mm_loadu_pd(inX + i))));
+#endif
+        for (; i <= j; i++)
+            column[i] += factor * inX[i];
+    }
+}
+
+/**
+ * @brief Expand a packed symmetric matrix into a full (column-major) matrix
+ *
+ * @param inN Number of rows (and columns) of the matrix
+ * @param inAP The matrix in packed storage
+ * @param outA Memory for the full matrix (\f$ n^2 \f$ elements)
+ */
+inline void unpackSymmetric(uint32_t inN, const double *inAP, double *outA) {
+    for (uint32_t j = 0; j < inN; j++) {
+        const double *column = inAP + packedColumnOffset(j);
+        for (uint32_t i = 0; i <= j; i++) {
+            outA[static_cast<std::size_t>(j) * inN + i] = column[i];
+            outA[static_cast<std::size_t>(i) * inN + j] = column[i];
+        }
+    }
+}
+
+/**
+ * @brief Store the upper triangle of a full (column-major) matrix in packed
+ *        storage
+ *
+ * @param inN Number of rows (and columns) of the matrix
+ * @param inA The full matrix
+ * @param outAP Memory for the packed matrix (packedSize(inN) elements)
+ */
+inline void packUpperTriangle(uint32_t inN, const double *inA, double *outAP) {
+    for (uint32_t j = 0; j < inN; j++) {
+        double *column = outAP + packedColumnOffset(j);
+        for (uint32_t i = 0; i <= j; i++)
+            column[i] = inA[static_cast<std::size_t>(j) * inN + i];
+    }
+}
+
+} // namespace utils
+
+} // namespace madlib
+
+#endif